@@ -5,15 +5,53 @@
 #include "main.h"
 #include "filer.h"
 #include "utility.h"
-#include "p_search.h"
+#include "library_search.h"
+
+#ifdef __SWITCH__
+
+#include <switch.h>
+
+#endif
 
 #define ITEM_HEIGHT 50
 
 using namespace c2d;
 
+#ifdef __SWITCH__
+
+static bool get_keyboard_text(const std::string &guide, const std::string &initial, std::string *text) {
+
+    SwkbdConfig kbd;
+    char out[256] = {0};
+
+    if (R_FAILED(swkbdCreate(&kbd, 0))) {
+        return false;
+    }
+
+    swkbdConfigMakePresetDefault(&kbd);
+    swkbdConfigSetGuideText(&kbd, guide.c_str());
+    swkbdConfigSetInitialText(&kbd, initial.c_str());
+    Result rc = swkbdShow(&kbd, out, sizeof(out));
+    swkbdClose(&kbd);
+
+    if (R_FAILED(rc)) {
+        return false;
+    }
+
+    *text = out;
+    return true;
+}
+
+#endif
+
+// FilerList::SortMode order
+static const char *sort_modes[] = {"Title", "Name", "Size", "Duration", "Resolution", "Played"};
+#define SORT_MODE_COUNT 6
+
 Filer::Filer(Main *m, const std::string &path, const c2d::FloatRect &rect) : Rectangle(rect) {
 
     main = m;
+    scrapsMutex = SDL_CreateMutex();
 
     // force scrap view width to scrapped backdrop width
     scrapView = new ScrapView(main, {rect.width - 780, 0, 780, rect.height});
@@ -31,6 +69,15 @@ Filer::Filer(Main *m, const std::string &path, const c2d::FloatRect &rect) : Rec
         item_height = size.y / (float) item_max;
     }
 
+    // metadata of current page and a few around
+    files = FilerList((size_t) item_max * 4);
+    std::string sortMode = main->getConfig()->getOption(OPT_SORT_MODE)->getString();
+    for (int i = 0; i < SORT_MODE_COUNT; i++) {
+        if (sortMode == sort_modes[i]) {
+            files.setSortMode((FilerList::SortMode) i);
+        }
+    }
+
     for (unsigned int i = 0; i < (unsigned int) item_max; i++) {
         FloatRect r = {0, (item_height * i) + 1, size.x - 2, item_height - 2};
         items.emplace_back(new FilerItem(main, r));
@@ -41,53 +88,223 @@ Filer::Filer(Main *m, const std::string &path, const c2d::FloatRect &rect) : Rec
     add(new TweenAlpha(0, 255, 0.5f));
 }
 
+Filer::~Filer() {
+#ifndef __SWITCH__
+    if (typing) {
+        stopTyping();
+    }
+#endif
+    SDL_DestroyMutex(scrapsMutex);
+}
+
 void Filer::setMediaInfo(const MediaFile &target, const MediaInfo &mediaInfo) {
 
-    for (size_t i = 0; i < files.size(); i++) {
-        if (files[i].path == target.path) {
-            files[i].mediaInfo = mediaInfo;
-            dirty = true;
+    int index = files.find(target.path);
+    if (index < 0) {
+        return;
+    }
+
+    if (!mediaInfo.videos.empty() || !mediaInfo.audios.empty()) {
+        files.setFlags((size_t) index, files.getFlags((size_t) index) | FilerList::Probed);
+    }
+    if (files.setMediaInfo((size_t) index, mediaInfo)) {
+        sort({(size_t) index});
+    }
+    dirty = true;
+}
+
+void Filer::setScrapInfo(const Io::File &target, const std::vector<pscrap::Movie> &movies) {
+
+    // called from scrapper thread, list is only modified from ui thread (onUpdate)
+    SDL_LockMutex(scrapsMutex);
+    scraps.emplace_back(target.path, movies);
+    SDL_UnlockMutex(scrapsMutex);
+}
+
+size_t Filer::getCount() const {
+    return filter.empty() ? files.size() : view.size();
+}
+
+size_t Filer::getRow(size_t index) const {
+    return filter.empty() ? index : view[index];
+}
+
+bool Filer::isVisible(size_t row) const {
+
+    size_t index_start = (size_t) (item_index / item_max) * item_max;
+    for (size_t i = index_start; i < getCount() && i < index_start + item_max; i++) {
+        if (getRow(i) == row) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Filer::setFilter(const std::string &query) {
+
+    // keep selection on the same file if still listed
+    std::string selection = (size_t) item_index < getCount() ? files.getPath(getRow((size_t) item_index)) : "";
+
+    filter = query;
+    view = filter.empty() ? std::vector<size_t>() : search.find(files, filter);
+
+    item_index = 0;
+    for (size_t i = 0; i < getCount(); i++) {
+        if (files.getPath(getRow(i)) == selection) {
+            item_index = (int) i;
             break;
         }
     }
+
+    item_page = -1;
+    setSelection(item_index);
 }
 
-void Filer::setScrapInfo(const Io::File &target, const std::vector<pscrap::Movie> &movies) {
+// first letter of displayed title (or name), digits and symbols are grouped
+static char get_letter(const FilerList &files, size_t row) {
 
-    for (size_t i = 0; i < files.size(); i++) {
-        if (files[i].path == target.path) {
-            files[i].movies = movies;
-            dirty = true;
+    const std::string &title = files.getTitle(row);
+    char c = title.empty() || files.getSortMode() == FilerList::SortMode::Name ? files.getName(row)[0] : title[0];
+    c = (char) tolower((unsigned char) c);
+
+    return (c >= 'a' && c <= 'z') ? c : '#';
+}
+
+void Filer::jump(int direction) {
+
+    auto count = (int) getCount();
+    if (count < 2) {
+        return;
+    }
+
+    // next row starting with another letter
+    int index = item_index;
+    char letter = get_letter(files, getRow((size_t) index));
+    for (int i = 1; i < count; i++) {
+        index = (index + direction + count) % count;
+        if (get_letter(files, getRow((size_t) index)) != letter) {
             break;
         }
     }
+
+    // backward: first row of that letter
+    if (direction < 0) {
+        letter = get_letter(files, getRow((size_t) index));
+        while (index > 0 && get_letter(files, getRow((size_t) index - 1)) == letter) {
+            index--;
+        }
+    }
+
+    setSelection(index);
 }
 
+#ifndef __SWITCH__
+
+bool Filer::startTyping(bool library) {
+
+    // no video subsystem, no keyboard events
+    if (!SDL_WasInit(SDL_INIT_VIDEO)) {
+        return false;
+    }
+
+    if (!typing) {
+        typing = true;
+        typing_library = library;
+        typed = library ? "" : filter;
+        typing_restore = SDL_IsTextInputActive() == SDL_TRUE;
+        SDL_AddEventWatch(onTextInput, this);
+        SDL_StartTextInput();
+    }
+    main->getStatus()->show(library ? "Search library..." : "Search...",
+                            "Type to search, enter to validate, escape to clear");
+
+    return true;
+}
+
+void Filer::stopTyping() {
+
+    SDL_DelEventWatch(onTextInput, this);
+    if (!typing_restore) {
+        SDL_StopTextInput();
+    }
+    typing = false;
+    typing_stopped = true;
+}
+
+int Filer::onTextInput(void *data, SDL_Event *event) {
+
+    auto filer = (Filer *) data;
+    if (!filer->typing) {
+        return 0;
+    }
+
+    if (event->type == SDL_TEXTINPUT) {
+        filer->typed += event->text.text;
+        filer->typed_changed = true;
+    } else if (event->type == SDL_KEYDOWN) {
+        SDL_Keycode key = event->key.keysym.sym;
+        if (key == SDLK_BACKSPACE && !filer->typed.empty()) {
+            // remove last utf-8 character
+            while (filer->typed.size() > 1 && (filer->typed.back() & 0xC0) == 0x80) {
+                filer->typed.pop_back();
+            }
+            filer->typed.pop_back();
+            filer->typed_changed = true;
+        } else if (key == SDLK_RETURN || key == SDLK_KP_ENTER) {
+            filer->stopTyping();
+        } else if (key == SDLK_ESCAPE) {
+            filer->typed.clear();
+            filer->typed_changed = true;
+            filer->stopTyping();
+        }
+    }
+
+    return 0;
+}
+
+#endif
+
 void Filer::setSelection(int index) {
 
     item_index = index;
     int page = item_index / item_max;
     unsigned int index_start = (unsigned int) page * item_max;
 
+    if (page != item_page) {
+        // load / probe visible rows first
+        std::vector<std::string> paths;
+        std::vector<Io::File> reload;
+        for (unsigned int i = index_start; i < getCount() && i < index_start + item_max; i++) {
+            size_t row = getRow(i);
+            paths.emplace_back(files.getPath(row));
+            // metadata dropped from cache
+            if ((files.getFlags(row) & FilerList::Loaded) && !files.getMediaFile(row)) {
+                reload.emplace_back(files.getFile(row));
+            }
+        }
+        if (!reload.empty()) {
+            main->getMediaLoader()->add(reload);
+        }
+        main->getMediaLoader()->prioritize(paths);
+        main->getProber()->prioritize(paths);
+        item_page = page;
+    }
+
     for (unsigned int i = 0; i < (unsigned int) item_max; i++) {
-        if (index_start + i >= files.size()) {
+        if (index_start + i >= getCount()) {
             items[i]->setVisibility(Visibility::Hidden);
         } else {
-            // load media info, set file
-            MediaFile file = files[index_start + i];
-            items[i]->setFile(file);
+            items[i]->setIndex(&files, getRow(index_start + i));
             items[i]->setVisibility(Visibility::Visible);
-            if (!file.movies.empty()) {
-                items[i]->setTitle(file.movies[0].title);
-            }
             // set highlight position
             if (index_start + i == (unsigned int) item_index) {
                 highlight->tweenTo(items[i]->getPosition());
-                if (file.type == Io::Type::File) {
+                if (files.getType(getRow(index_start + i)) == Io::Type::File) {
                     if (!scrapView->isVisible()) {
                         scrapView->setVisibility(Visibility::Visible);
                     }
-                    scrapView->setMovie(file);
+                    scrapView->setMovie(getSelection());
                 } else {
                     scrapView->setVisibility(Visibility::Hidden);
                 }
@@ -95,17 +312,22 @@ void Filer::setSelection(int index) {
         }
     }
 
-    if (files.empty()) {
+    if (getCount() == 0) {
         highlight->setVisibility(Visibility::Hidden);
     } else {
         highlight->setVisibility(Visibility::Visible);
     }
 }
 
-MediaFile Filer::getSelection() const {
+MediaFile Filer::getSelection() {
 
-    if (!files.empty() && files.size() > (unsigned int) item_index) {
-        return files[item_index];
+    if (getCount() > (unsigned int) item_index) {
+        size_t row = getRow((size_t) item_index);
+        const MediaFile *file = files.getMediaFile(row);
+        if (file) {
+            return *file;
+        }
+        return MediaFile(files.getFile(row), MediaInfo());
     }
 
     return MediaFile();
@@ -115,22 +337,56 @@ bool Filer::onInput(c2d::Input::Player *players) {
 
     if (main->getMenuMain()->isMenuVisible()
         || main->getPlayer()->isFullscreen()) {
+#ifndef __SWITCH__
+        if (typing) {
+            stopTyping();
+        }
+#endif
         return false;
     }
 
     unsigned int keys = players[0].keys;
 
-    if (keys & c2d::Input::Start || keys & c2d::Input::Select) {
+#ifndef __SWITCH__
+    // letters may be mapped to buttons, only move in the list while typing
+    if (typing || typing_stopped) {
+        typing_stopped = false;
+        if (getCount() > 0 && (keys & Input::Key::Up || keys & Input::Key::Down)) {
+            item_index = (item_index + (keys & Input::Key::Up ? -1 : 1) + (int) getCount()) % (int) getCount();
+            setSelection(item_index);
+            scrapView->unload();
+        }
+        return true;
+    }
+#endif
+
+    if (keys & c2d::Input::Start) {
         main->getMenuMain()->setVisibility(Visibility::Visible, true);
+    } else if (keys & c2d::Input::Select) {
+        // search in current directory
+#ifdef __SWITCH__
+        std::string query;
+        if (get_keyboard_text("Search", filter, &query)) {
+            scrapView->unload();
+            setFilter(query);
+            if (!filter.empty()) {
+                main->getStatus()->show("Search...", std::to_string(view.size()) + " matches for \"" + filter + "\"");
+            }
+        }
+#else
+        if (!startTyping()) {
+            main->getMenuMain()->setVisibility(Visibility::Visible, true);
+        }
+#endif
     } else if (keys & Input::Key::Up) {
         item_index--;
         if (item_index < 0)
-            item_index = (int) (files.size() - 1);
+            item_index = (int) getCount() - 1;
         setSelection(item_index);
         scrapView->unload();
     } else if (keys & Input::Key::Down) {
         item_index++;
-        if (item_index >= (int) files.size()) {
+        if (item_index >= (int) getCount()) {
             item_index = 0;
         }
         setSelection(item_index);
@@ -147,13 +403,36 @@ bool Filer::onInput(c2d::Input::Player *players) {
             scrapView->unload();
             enter(item_index);
         } else if (pplay::Utility::isMedia(getSelection())) {
-            main->getPlayer()->load(files[item_index]);
+            MediaFile file = getSelection();
+            if (!files.getMediaFile(getRow((size_t) item_index))) {
+                // not loaded yet (or dropped from cache)
+                file.mediaInfo = MediaInfo(file);
+            }
+            main->getPlayer()->load(file);
         }
     } else if (keys & Input::Key::Fire2) {
         scrapView->unload();
-        exit();
+        if (!filter.empty()) {
+            setFilter("");
+        } else {
+            exit();
+        }
     } else if (keys & Input::Key::Fire3) {
         main->getScrapper()->scrap(path);
+    } else if (keys & Input::Key::Fire4) {
+        // next sort mode
+        int mode = ((int) files.getSortMode() + 1) % SORT_MODE_COUNT;
+        files.setSortMode((FilerList::SortMode) mode);
+        main->getConfig()->getOption(OPT_SORT_MODE)->setString(sort_modes[mode]);
+        main->getConfig()->save();
+        sort();
+        main->getStatus()->show("Sort...", std::string("Sorted by ") + sort_modes[mode]);
+    } else if (keys & Input::Key::Fire5) {
+        scrapView->unload();
+        jump(-1);
+    } else if (keys & Input::Key::Fire6) {
+        scrapView->unload();
+        jump(1);
     }
 
     return true;
@@ -161,27 +440,88 @@ bool Filer::onInput(c2d::Input::Player *players) {
 
 void Filer::onUpdate() {
 
-    if (dirty) {
-        setSelection(item_index);
-        dirty = false;
+#ifndef __SWITCH__
+    // input of this frame was handled
+    typing_stopped = false;
+    // filter as typed, key by key
+    if (typed_changed) {
+        typed_changed = false;
+        scrapView->unload();
+        if (typing_library) {
+            getResults(typed);
+        } else {
+            setFilter(typed);
+        }
+        if (typing && !typing_library) {
+            main->getStatus()->show("Search...", "\"" + filter + "\": " + std::to_string(view.size()) + " matches");
+        }
+    }
+#endif
+
+    // background loaded media info / scrap data
+    std::vector<size_t> changed;
+    std::vector<Io::File> probes;
+    main->getMediaLoader()->poll([this, &changed, &probes](pplay::MediaLoader::Result &result) {
+        int index = files.find(result.file.path);
+        if (index < 0) {
+            return;
+        }
+        // title, duration.. (sort keys) changed
+        bool moved = files.setTitle((size_t) index, result.movies.empty() ? "" : result.movies[0].title);
+        moved = files.setMediaInfo((size_t) index, result.mediaInfo) || moved;
+        if (moved) {
+            changed.push_back((size_t) index);
+        }
+        bool loaded = (files.getFlags((size_t) index) & FilerList::Loaded) != 0;
+        bool probed = !result.mediaInfo.videos.empty() || !result.mediaInfo.audios.empty();
+        files.setFlags((size_t) index, FilerList::Loaded | (probed ? FilerList::Probed : 0));
+        // only keep metadata of displayed (or already cached) rows
+        if (isVisible((size_t) index) || files.getMediaFile((size_t) index)) {
+            files.setMediaFile((size_t) index, result.mediaInfo, result.movies);
+        }
+        // never played nor probed
+        if (!loaded && !probed && pplay::Utility::isMedia(result.file)) {
+            probes.emplace_back(result.file);
+        }
+        dirty = true;
+    });
+
+    // scrapper results
+    std::vector<std::pair<std::string, std::vector<pscrap::Movie>>> scrapped;
+    SDL_LockMutex(scrapsMutex);
+    scrapped.swap(scraps);
+    SDL_UnlockMutex(scrapsMutex);
+    for (auto &scrap : scrapped) {
+        int index = files.find(scrap.first);
+        if (index < 0) {
+            continue;
+        }
+        files.setMovies((size_t) index, scrap.second);
+        if (files.setTitle((size_t) index, scrap.second.empty() ? "" : scrap.second[0].title)) {
+            changed.push_back((size_t) index);
+        }
+        dirty = true;
     }
 
-    C2DObject::onUpdate();
-}
-
-static bool compare(const MediaFile &a, const MediaFile &b) {
-
-    if (a.type == Io::Type::Directory && b.type != Io::Type::Directory) {
-        return true;
+    // results stay in relevance order
+    if (!changed.empty() && !results) {
+        sort(changed);
     }
-    if (a.type != Io::Type::Directory && b.type == Io::Type::Directory) {
-        return false;
+
+    if (!probes.empty()) {
+        main->getProber()->add(probes);
     }
 
-    std::string aa = a.movies.empty() ? a.name : a.movies[0].title;
-    std::string bb = b.movies.empty() ? b.name : b.movies[0].title;
+    main->getProber()->poll([this](const Io::File &file, const MediaInfo &mediaInfo) {
+        setMediaInfo(MediaFile(file, mediaInfo), mediaInfo);
+    });
+
+    if (dirty) {
+        setSelection(item_index);
+        dirty = false;
+    }
 
-    return Utility::toLower(aa) < Utility::toLower(bb);
+    C2DObject::onUpdate();
 }
 
 bool Filer::getDir(const std::string &p) {
@@ -189,6 +529,10 @@ bool Filer::getDir(const std::string &p) {
     printf("getDir(%s)\n", p.c_str());
 
     files.clear();
+    filter.clear();
+    view.clear();
+    search.clear();
+    results = false;
     path = p;
     if (path.size() > 1 && Utility::endsWith(path, "/")) {
         path = Utility::removeLastSlash(path);
@@ -199,34 +543,53 @@ bool Filer::getDir(const std::string &p) {
     std::vector<Io::File> _files =
             ((pplay::Io *) main->getIo())->getDirList(type, ext, path, false);
 
+    // show names now, media info and scrap data (titles) are loaded in background
+    files.reserve(_files.size() + 1);
+    files.add(Io::File("..", "..", Io::Type::Directory, 0, COLOR_BLUE));
     for (auto &file : _files) {
-        MediaFile mf(file, MediaInfo(file));
-        if (file.type == Io::Type::File) {
-            pscrap::Search search;
-            std::string scrapPath = pplay::Utility::getMediaScrapPath(file);
-            if (main->getIo()->exist(scrapPath)) {
-                search.load(scrapPath);
-                if (search.total_results > 0) {
-                    mf.movies = search.movies;
-                }
-            }
+        if (file.name != "..") {
+            files.add(file);
         }
-        files.emplace_back(mf);
     }
+    files.sort(1);
 
-    // sort after title have been scrapped
-    std::sort(files.begin(), files.end(), compare);
-
-    if (files.empty() || files.at(0).name != "..") {
-        Io::File file("..", "..", Io::Type::Directory, 0, COLOR_BLUE);
-        files.insert(files.begin(), MediaFile{file, MediaInfo(file)});
+    std::vector<Io::File> pending;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (files.getType(i) == Io::Type::File) {
+            pending.emplace_back(files.getFile(i));
+        }
     }
+    // probing is queued once media info is known to be missing
+    main->getProber()->probe({});
+    main->getMediaLoader()->load(pending);
 
+    item_page = -1;
     setSelection(0);
 
     return true;
 }
 
+void Filer::sort(const std::vector<size_t> &changed) {
+
+    // keep selection on the same file (".." stays first)
+    std::string selection = (size_t) item_index < getCount() ? files.getPath(getRow((size_t) item_index)) : "";
+    files.sort(1, changed);
+
+    if (!filter.empty()) {
+        // rows moved, search again (keeps selection)
+        setFilter(filter);
+        return;
+    }
+
+    int index = files.find(selection);
+    if (index >= 0) {
+        item_index = index;
+    }
+
+    item_page = -1;
+    dirty = true;
+}
+
 void Filer::enter(int index) {
 
     MediaFile file = getSelection();
@@ -243,13 +606,19 @@ void Filer::enter(int index) {
         success = getDir(path + "/" + file.name);
     }
     if (success) {
-        item_index_prev.push_back(index);
+        // rows are re-sorted while loading, the entry is found back by path
+        item_index_prev.push_back(file.path);
         setSelection(item_index);
     }
 }
 
 void Filer::exit() {
 
+    if (results) {
+        getResults("");
+        return;
+    }
+
     std::string p = path;
 
     if (p == "/" || p.find('/') == std::string::npos) {
@@ -277,16 +646,70 @@ void Filer::exit() {
 
     if (getDir(p)) {
         if (!item_index_prev.empty()) {
-            int last = (int) item_index_prev.size() - 1;
-            if (item_index_prev[last] < (int) files.size()) {
-                item_index = item_index_prev[last];
+            int row = files.find(item_index_prev.back());
+            if (row >= 0) {
+                item_index = row;
             }
-            item_index_prev.erase(item_index_prev.end() - 1);
+            item_index_prev.pop_back();
         }
         setSelection(item_index);
     }
 }
 
+void Filer::searchLibrary() {
+
+    setVisibility(Visibility::Visible, true);
+    scrapView->unload();
+#ifdef __SWITCH__
+    std::string query;
+    if (get_keyboard_text("Search library", "", &query)) {
+        getResults(query);
+    }
+#else
+    if (typing) {
+        stopTyping();
+    }
+    if (!startTyping(true)) {
+        main->getStatus()->show("Search library...", "No keyboard available on this platform");
+    }
+#endif
+}
+
+void Filer::getResults(const std::string &query) {
+
+    if (query.empty()) {
+        if (results) {
+            getDir(path);
+        }
+        return;
+    }
+
+    std::vector<pplay::LibrarySearch::Result> found = pplay::LibrarySearch::getInstance()->find(query);
+
+    files.clear();
+    filter.clear();
+    view.clear();
+    search.clear();
+    results = true;
+
+    // media files anywhere in the library, played from their path
+    files.reserve(found.size() + 1);
+    files.add(Io::File("..", "..", Io::Type::Directory, 0, COLOR_BLUE));
+    std::vector<Io::File> pending;
+    for (auto &result : found) {
+        Io::File file(result.path.substr(result.path.find_last_of('/') + 1), result.path, Io::Type::File, 0);
+        files.add(file);
+        pending.push_back(file);
+    }
+    main->getProber()->probe({});
+    main->getMediaLoader()->load(pending);
+
+    item_page = -1;
+    setSelection(0);
+
+    main->getStatus()->show("Search library...", std::to_string(found.size()) + " results for \"" + query + "\"");
+}
+
 void Filer::clearHistory() {
     item_index_prev.clear();
 }
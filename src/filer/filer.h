@@ -5,11 +5,16 @@
 #ifndef NXFILER_FILER_H
 #define NXFILER_FILER_H
 
+#include <SDL2/SDL_events.h>
+#include <SDL2/SDL_thread.h>
+
 #include "cross2d/c2d.h"
 
 #include "outline_rect.h"
 #include "pplay_config.h"
 #include "filer_item.h"
+#include "filer_list.h"
+#include "filer_search.h"
 #include "media_file.h"
 #include "highlight.h"
 #include "scrap_view.h"
@@ -22,20 +27,26 @@ public:
 
     Filer(Main *main, const std::string &path, const c2d::FloatRect &rect);
 
+    ~Filer() override;
+
     void setMediaInfo(const MediaFile &target, const MediaInfo &mediaInfo);
 
+    // thread safe (scrapper), applied on next update
     void setScrapInfo(const c2d::Io::File &target, const std::vector<pscrap::Movie> &movies);
 
     virtual bool getDir(const std::string &path);
 
     virtual std::string getPath();
 
-    virtual MediaFile getSelection() const;
+    virtual MediaFile getSelection();
 
     virtual void setSelection(int index);
 
     virtual void clearHistory();
 
+    // query the library search index, results are listed in place of the current directory
+    void searchLibrary();
+
     virtual std::string getError() { return ""; };
 
     bool onInput(c2d::Input::Player *players) override;
@@ -48,16 +59,69 @@ private:
 
     virtual void exit();
 
+    // only "changed" rows are moved if given
+    void sort(const std::vector<size_t> &changed = {});
+
+    // type-ahead search, empty query shows all rows
+    void setFilter(const std::string &query);
+
+    // list library search results (best first), empty query lists the directory again
+    void getResults(const std::string &query);
+
+    // previous / next letter
+    void jump(int direction);
+
+#ifndef __SWITCH__
+
+    // type-ahead from keyboard (sdl text input), false if not available.
+    // "library": typed query searches the library instead of filtering the directory
+    bool startTyping(bool library = false);
+
+    void stopTyping();
+
+    // sdl event watch, called while pumping events (ui thread)
+    static int onTextInput(void *data, SDL_Event *event);
+
+#endif
+
+    // displayed rows count, list index of a displayed row
+    size_t getCount() const;
+
+    size_t getRow(size_t index) const;
+
+    // list row is on current page
+    bool isVisible(size_t row) const;
+
     Main *main;
     std::string path;
     std::vector<FilerItem *> items;
-    std::vector<MediaFile> files;
+    FilerList files;
+    FilerSearch search;
+    std::string filter;
+    std::vector<size_t> view;
+    // rows are library search results, "path" is the directory to go back to
+    bool results = false;
     Highlight *highlight;
     ScrapView *scrapView;
     float item_height;
     int item_max;
     int item_index = 0;
-    std::vector<int> item_index_prev;
+    int item_page = -1;
+    std::vector<std::string> item_index_prev;
+    // scrapper results, applied from ui thread
+    std::vector<std::pair<std::string, std::vector<pscrap::Movie>>> scraps;
+    SDL_mutex *scrapsMutex = nullptr;
+#ifndef __SWITCH__
+    // query being typed, applied on next update
+    std::string typed;
+    bool typed_changed = false;
+    bool typing = false;
+    bool typing_library = false;
+    // typing ended this frame (enter / escape may also be mapped to buttons)
+    bool typing_stopped = false;
+    // text input state to restore when done
+    bool typing_restore = false;
+#endif
 
     bool dirty = false;
 };
@@ -11,12 +11,11 @@
 
 using namespace c2d;
 
-FilerItem::FilerItem(Main *main, const c2d::FloatRect &rect, const MediaFile &file) : Rectangle(rect) {
+FilerItem::FilerItem(Main *main, const c2d::FloatRect &rect) : Rectangle(rect) {
 
     this->main = main;
-    this->file = file;
 
-    textTitle = new Text(file.name, main->getFontSize(Main::FontSize::Medium), main->getFont());
+    textTitle = new Text("", main->getFontSize(Main::FontSize::Medium), main->getFont());
     textTitle->setPosition(16, 4);
     textTitle->setSizeMax(getSize().x - 64, 0);
     add(textTitle);
@@ -28,20 +27,30 @@ FilerItem::FilerItem(Main *main, const c2d::FloatRect &rect, const MediaFile &fi
     add(textInfo);
 }
 
-void FilerItem::setFile(const MediaFile &f) {
+void FilerItem::setIndex(const FilerList *list, size_t index) {
 
-    this->file = f;
+    Io::Type type = list->getType(index);
+    const std::string &title = list->getTitle(index);
 
-    textTitle->setString(file.name);
+    if (title.empty()) {
+        textTitle->setString(list->getName(index));
+    } else {
+        textTitle->setString(title);
+    }
     uint8_t alpha = textTitle->getAlpha();
-    if (file.type == Io::Type::Directory) {
+    if (type == Io::Type::Directory) {
         textTitle->setFillColor(COLOR_BLUE);
     } else {
         textTitle->setFillColor(COLOR_RED);
     }
     textTitle->setAlpha(alpha);
-    if (file.type == Io::Type::File) {
-        textInfo->setString(file.name);
+    if (type == Io::Type::File) {
+        size_t size = list->getSize(index);
+        if (size > 0) {
+            textInfo->setString(std::string(list->getName(index)) + " - " + pplay::Utility::formatSize(size));
+        } else {
+            textInfo->setString(list->getName(index));
+        }
     } else {
         textInfo->setString("");
     }
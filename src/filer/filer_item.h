@@ -6,7 +6,7 @@
 #define PPLAY_FILERITEM_H
 
 #include "cross2d/skeleton/sfml/RectangleShape.hpp"
-#include "media_file.h"
+#include "filer_list.h"
 
 class Main;
 
@@ -14,16 +14,16 @@ class FilerItem : public c2d::Rectangle {
 
 public:
 
-    FilerItem(Main *main, const c2d::FloatRect &rect, const MediaFile &file = {});
+    FilerItem(Main *main, const c2d::FloatRect &rect);
 
-    void setFile(const MediaFile &file);
+    // bind to a list row, nothing is copied but displayed strings
+    void setIndex(const FilerList *list, size_t index);
 
     void setTitle(const std::string &title);
 
 private:
 
     Main *main;
-    MediaFile file;
 
     c2d::Text *textTitle;
     c2d::Text *textInfo;
@@ -0,0 +1,430 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include <algorithm>
+#include <functional>
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_cpuinfo.h>
+
+#include "cross2d/c2d.h"
+#include "filer_list.h"
+
+// split sorting of large directories on multiple threads
+#define PARALLEL_SORT_MIN       8192
+#define PARALLEL_SORT_THREADS   4
+// full sort above this count of changed rows
+#define INCREMENTAL_SORT_MAX    256
+
+using namespace c2d;
+
+typedef std::function<bool(uint32_t a, uint32_t b)> Compare;
+
+class SortJob {
+public:
+    uint32_t *begin;
+    uint32_t *end;
+    const Compare *compare;
+};
+
+static int sort_thread(void *ptr) {
+
+    auto job = (SortJob *) ptr;
+    std::stable_sort(job->begin, job->end, *job->compare);
+
+    return 0;
+}
+
+static void parallel_sort(std::vector<uint32_t> &order, const Compare &compare) {
+
+    int count = std::min(SDL_GetCPUCount(), PARALLEL_SORT_THREADS);
+    if (order.size() < PARALLEL_SORT_MIN || count < 2) {
+        std::stable_sort(order.begin(), order.end(), compare);
+        return;
+    }
+
+    std::vector<SortJob> jobs((size_t) count);
+    std::vector<SDL_Thread *> threads((size_t) count);
+    size_t chunk = order.size() / count;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        jobs[i].begin = order.data() + i * chunk;
+        jobs[i].end = i == jobs.size() - 1 ? order.data() + order.size() : jobs[i].begin + chunk;
+        jobs[i].compare = &compare;
+        threads[i] = SDL_CreateThread(sort_thread, "sort_thread", (void *) &jobs[i]);
+        if (!threads[i]) {
+            sort_thread(&jobs[i]);
+        }
+    }
+
+    for (auto thread : threads) {
+        if (thread) {
+            SDL_WaitThread(thread, nullptr);
+        }
+    }
+
+    // merge sorted chunks, left to right (stable)
+    for (size_t i = 1; i < jobs.size(); i++) {
+        std::inplace_merge(order.data(), jobs[i].begin, jobs[i].end, compare);
+    }
+}
+
+// case folded (ascii) collation key, numbers are compared by value:
+// each digits run is prefixed by its length (two digits), without leading zeros
+static std::string make_key(const std::string &str) {
+
+    std::string key;
+    key.reserve(str.size() + 8);
+
+    size_t i = 0;
+    while (i < str.size()) {
+        auto c = (unsigned char) str[i];
+        if (c >= '0' && c <= '9') {
+            size_t start = i;
+            while (i < str.size() && str[i] >= '0' && str[i] <= '9') {
+                i++;
+            }
+            while (start < i - 1 && str[start] == '0') {
+                start++;
+            }
+            size_t len = std::min(i - start, (size_t) 99);
+            key.push_back((char) ('0' + len / 10));
+            key.push_back((char) ('0' + len % 10));
+            key.append(str, start, i - start);
+        } else {
+            key.push_back(c < 0x80 ? (char) tolower(c) : (char) c);
+            i++;
+        }
+    }
+
+    return key;
+}
+
+template<typename T>
+static void permute(std::vector<T> &column, const std::vector<uint32_t> &order, size_t first) {
+
+    std::vector<T> sorted;
+    sorted.reserve(order.size());
+    for (uint32_t i : order) {
+        sorted.emplace_back(std::move(column[i]));
+    }
+    std::move(sorted.begin(), sorted.end(), column.begin() + first);
+}
+
+FilerList::FilerList(size_t cacheSize) {
+    cache_size = cacheSize;
+}
+
+void FilerList::clear() {
+
+    pool.clear();
+    names.clear();
+    paths.clear();
+    types.clear();
+    sizes.clear();
+    colors.clear();
+    titles.clear();
+    flags.clear();
+    name_keys.clear();
+    title_keys.clear();
+    durations.clear();
+    resolutions.clear();
+    played.clear();
+    ids.clear();
+    positions.clear();
+    lookup.clear();
+    cache.clear();
+    cache_index.clear();
+    version++;
+}
+
+void FilerList::reserve(size_t count) {
+
+    ids.reserve(count);
+    positions.reserve(count);
+    names.reserve(count);
+    paths.reserve(count);
+    types.reserve(count);
+    sizes.reserve(count);
+    colors.reserve(count);
+    titles.reserve(count);
+    flags.reserve(count);
+    name_keys.reserve(count);
+    title_keys.reserve(count);
+    durations.reserve(count);
+    resolutions.reserve(count);
+    played.reserve(count);
+}
+
+uint32_t FilerList::addString(const std::string &str) {
+
+    auto offset = (uint32_t) pool.size();
+    pool.insert(pool.end(), str.begin(), str.end());
+    pool.push_back('\0');
+
+    return offset;
+}
+
+void FilerList::add(const Io::File &file) {
+
+    auto id = (uint32_t) types.size();
+    lookup.emplace(std::hash<std::string>()(file.path), id);
+    ids.push_back(id);
+    positions.push_back(id);
+    names.push_back(addString(file.name));
+    paths.push_back(addString(file.path));
+    types.push_back(file.type);
+    sizes.push_back(file.size);
+    colors.push_back(file.color);
+    titles.emplace_back();
+    flags.push_back(0);
+    name_keys.emplace_back(make_key(file.name));
+    title_keys.emplace_back();
+    durations.push_back(0);
+    resolutions.push_back(0);
+    played.push_back(0);
+    version++;
+}
+
+const char *FilerList::getName(size_t index) const {
+    return pool.data() + names[index];
+}
+
+const char *FilerList::getPath(size_t index) const {
+    return pool.data() + paths[index];
+}
+
+Io::Type FilerList::getType(size_t index) const {
+    return types[index];
+}
+
+const std::string &FilerList::getTitle(size_t index) const {
+    return titles[index];
+}
+
+bool FilerList::setTitle(size_t index, const std::string &title) {
+
+    if (title == titles[index]) {
+        return false;
+    }
+
+    titles[index] = title;
+    version++;
+    title_keys[index] = title.empty() ? std::string() : make_key(title);
+
+    // also used to sort rows with equal size, duration..
+    return sort_mode != SortMode::Name;
+}
+
+int FilerList::getFlags(size_t index) const {
+    return flags[index];
+}
+
+void FilerList::setFlags(size_t index, int f) {
+    flags[index] = (uint8_t) f;
+}
+
+Io::File FilerList::getFile(size_t index) const {
+
+    return Io::File(getName(index), getPath(index), types[index], sizes[index], colors[index]);
+}
+
+const MediaFile *FilerList::getMediaFile(size_t index) {
+
+    auto it = cache_index.find(paths[index]);
+    if (it == cache_index.end()) {
+        return nullptr;
+    }
+
+    // most recently used
+    cache.splice(cache.begin(), cache, it->second);
+
+    return &it->second->second;
+}
+
+void FilerList::setMediaFile(size_t index, const MediaInfo &mediaInfo, const std::vector<pscrap::Movie> &movies) {
+
+    uint32_t key = paths[index];
+    auto it = cache_index.find(key);
+    if (it != cache_index.end()) {
+        cache.splice(cache.begin(), cache, it->second);
+    } else {
+        if (cache.size() >= cache_size) {
+            cache_index.erase(cache.back().first);
+            cache.pop_back();
+        }
+        cache.emplace_front(key, MediaFile(getFile(index), MediaInfo()));
+        cache_index[key] = cache.begin();
+    }
+
+    MediaFile &file = cache.front().second;
+    file.mediaInfo = mediaInfo;
+    file.movies = movies;
+}
+
+bool FilerList::setMediaInfo(size_t index, const MediaInfo &mediaInfo) {
+
+    auto it = cache_index.find(paths[index]);
+    if (it != cache_index.end()) {
+        it->second->second.mediaInfo = mediaInfo;
+    }
+
+    long duration = mediaInfo.duration;
+    int resolution = mediaInfo.videos.empty() ? 0 : mediaInfo.videos[0].width * mediaInfo.videos[0].height;
+    long last = mediaInfo.playbackInfo.last_played;
+    bool changed = (sort_mode == SortMode::Duration && duration != durations[index])
+                   || (sort_mode == SortMode::Resolution && resolution != resolutions[index])
+                   || (sort_mode == SortMode::Played && last != played[index]);
+
+    durations[index] = duration;
+    resolutions[index] = resolution;
+    played[index] = last;
+
+    return changed;
+}
+
+void FilerList::setMovies(size_t index, const std::vector<pscrap::Movie> &movies) {
+
+    auto it = cache_index.find(paths[index]);
+    if (it != cache_index.end()) {
+        it->second->second.movies = movies;
+    }
+}
+
+int FilerList::find(const std::string &path) const {
+
+    auto range = lookup.equal_range(std::hash<std::string>()(path));
+    for (auto it = range.first; it != range.second; ++it) {
+        uint32_t index = positions[it->second];
+        if (path == getPath(index)) {
+            return (int) index;
+        }
+    }
+
+    return -1;
+}
+
+void FilerList::buildIndex(size_t begin, size_t end) {
+
+    for (size_t i = begin; i < end; i++) {
+        positions[ids[i]] = (uint32_t) i;
+    }
+}
+
+bool FilerList::less(uint32_t a, uint32_t b) const {
+
+    bool aDir = types[a] == Io::Type::Directory;
+    bool bDir = types[b] == Io::Type::Directory;
+    if (aDir != bDir) {
+        return aDir;
+    }
+
+    if (aDir) {
+        return name_keys[a] < name_keys[b];
+    }
+
+    // biggest, longest.. first
+    switch (sort_mode) {
+        case SortMode::Size:
+            if (sizes[a] != sizes[b]) {
+                return sizes[a] > sizes[b];
+            }
+            break;
+        case SortMode::Duration:
+            if (durations[a] != durations[b]) {
+                return durations[a] > durations[b];
+            }
+            break;
+        case SortMode::Resolution:
+            if (resolutions[a] != resolutions[b]) {
+                return resolutions[a] > resolutions[b];
+            }
+            break;
+        case SortMode::Played:
+            if (played[a] != played[b]) {
+                return played[a] > played[b];
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (sort_mode == SortMode::Name) {
+        return name_keys[a] < name_keys[b];
+    }
+
+    const std::string &ka = title_keys[a].empty() ? name_keys[a] : title_keys[a];
+    const std::string &kb = title_keys[b].empty() ? name_keys[b] : title_keys[b];
+
+    return ka < kb;
+}
+
+void FilerList::sort(size_t first, const std::vector<size_t> &changed) {
+
+    if (first >= types.size()) {
+        return;
+    }
+
+    Compare compare = [this](uint32_t a, uint32_t b) {
+        return less(a, b);
+    };
+
+    std::vector<uint32_t> order;
+    order.reserve(types.size() - first);
+
+    if (!changed.empty() && changed.size() <= INCREMENTAL_SORT_MAX) {
+        // other rows are still sorted, move changed ones only
+        std::vector<bool> moved(types.size(), false);
+        for (size_t index : changed) {
+            if (index >= first && index < types.size()) {
+                moved[index] = true;
+            }
+        }
+        for (size_t i = first; i < types.size(); i++) {
+            if (!moved[i]) {
+                order.push_back((uint32_t) i);
+            }
+        }
+        for (size_t i = first; i < types.size(); i++) {
+            if (moved[i]) {
+                order.insert(std::upper_bound(order.begin(), order.end(), (uint32_t) i, compare), (uint32_t) i);
+            }
+        }
+    } else {
+        for (size_t i = first; i < types.size(); i++) {
+            order.push_back((uint32_t) i);
+        }
+        parallel_sort(order, compare);
+    }
+
+    // only move rows in the changed range
+    size_t begin = 0;
+    size_t end = order.size();
+    while (begin < end && order[begin] == first + begin) {
+        begin++;
+    }
+    while (end > begin && order[end - 1] == first + end - 1) {
+        end--;
+    }
+    if (begin == end) {
+        return;
+    }
+    order = std::vector<uint32_t>(order.begin() + begin, order.begin() + end);
+    begin += first;
+    end += first;
+
+    permute(ids, order, begin);
+    permute(names, order, begin);
+    permute(paths, order, begin);
+    permute(types, order, begin);
+    permute(sizes, order, begin);
+    permute(colors, order, begin);
+    permute(titles, order, begin);
+    permute(flags, order, begin);
+    permute(name_keys, order, begin);
+    permute(title_keys, order, begin);
+    permute(durations, order, begin);
+    permute(resolutions, order, begin);
+    permute(played, order, begin);
+
+    buildIndex(begin, end);
+}
@@ -0,0 +1,144 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_FILER_LIST_H
+#define PPLAY_FILER_LIST_H
+
+#include <list>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "cross2d/skeleton/io.h"
+#include "media_file.h"
+
+// filer list model: names, paths and types are kept in contiguous arrays
+// (struct of arrays, strings in a single pool), heavy metadata (media info,
+// scrapped movies) is only kept for recently displayed rows (lru)
+class FilerList {
+
+public:
+
+    // row flags
+    enum Flag {
+        // media info / scrap data loaded (by media loader)
+        Loaded = 1,
+        // media info has tracks (probed or played)
+        Probed = 2
+    };
+
+    enum class SortMode {
+        // scrapped title, or name
+        Title = 0,
+        Name,
+        Size,
+        Duration,
+        Resolution,
+        // recently played first
+        Played
+    };
+
+    explicit FilerList(size_t cacheSize = 64);
+
+    void clear();
+
+    void reserve(size_t count);
+
+    void add(const c2d::Io::File &file);
+
+    size_t size() const { return types.size(); };
+
+    bool empty() const { return types.empty(); };
+
+    const char *getName(size_t index) const;
+
+    const char *getPath(size_t index) const;
+
+    c2d::Io::Type getType(size_t index) const;
+
+    // listed size (0 if unknown)
+    size_t getSize(size_t index) const { return sizes[index]; };
+
+    // scrapped title, empty if none
+    const std::string &getTitle(size_t index) const;
+
+    // returns true if the row sort position may have changed
+    bool setTitle(size_t index, const std::string &title);
+
+    int getFlags(size_t index) const;
+
+    void setFlags(size_t index, int flags);
+
+    // light copy (no metadata)
+    c2d::Io::File getFile(size_t index) const;
+
+    // cached metadata, or nullptr if the row was not loaded recently
+    const MediaFile *getMediaFile(size_t index);
+
+    void setMediaFile(size_t index, const MediaInfo &mediaInfo, const std::vector<pscrap::Movie> &movies);
+
+    // update sort columns and cached metadata (if any),
+    // returns true if the row sort position may have changed
+    bool setMediaInfo(size_t index, const MediaInfo &mediaInfo);
+
+    void setMovies(size_t index, const std::vector<pscrap::Movie> &movies);
+
+    // index of path, or -1
+    int find(const std::string &path) const;
+
+    // row id (insertion order, not changed by sorting)
+    uint32_t getId(size_t index) const { return ids[index]; };
+
+    size_t getIndex(uint32_t id) const { return positions[id]; };
+
+    // incremented when rows or titles change (search index)
+    unsigned int getVersion() const { return version; };
+
+    SortMode getSortMode() const { return sort_mode; };
+
+    void setSortMode(SortMode mode) { sort_mode = mode; };
+
+    // sort rows from index "first", directories first (by name), then by sort mode.
+    // if "changed" rows are given only those are moved (everything else being sorted)
+    void sort(size_t first, const std::vector<size_t> &changed = {});
+
+private:
+
+    typedef std::list<std::pair<uint32_t, MediaFile>> Cache;
+
+    uint32_t addString(const std::string &str);
+
+    // update positions of rows in [begin, end)
+    void buildIndex(size_t begin, size_t end);
+
+    bool less(uint32_t a, uint32_t b) const;
+
+    // columns, pool offsets are used as stable row ids
+    std::vector<char> pool;
+    std::vector<uint32_t> names;
+    std::vector<uint32_t> paths;
+    std::vector<c2d::Io::Type> types;
+    std::vector<size_t> sizes;
+    std::vector<c2d::Color> colors;
+    std::vector<std::string> titles;
+    std::vector<uint8_t> flags;
+    // sort columns, collation keys are computed once (case folded, natural numbers order)
+    std::vector<std::string> name_keys;
+    std::vector<std::string> title_keys;
+    std::vector<long> durations;
+    std::vector<int> resolutions;
+    std::vector<long> played;
+    SortMode sort_mode = SortMode::Title;
+    unsigned int version = 0;
+    // path hash to row id (insertion order), row id to index
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> positions;
+    std::unordered_multimap<size_t, uint32_t> lookup;
+    // metadata lru, most recent first
+    Cache cache;
+    std::unordered_map<uint32_t, Cache::iterator> cache_index;
+    size_t cache_size;
+};
+
+#endif //PPLAY_FILER_LIST_H
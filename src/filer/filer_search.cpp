@@ -0,0 +1,217 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include <algorithm>
+
+#include "filer_search.h"
+
+static uint32_t trigram(const std::string &str, size_t pos) {
+    return ((uint32_t) (uint8_t) str[pos] << 16) | ((uint32_t) (uint8_t) str[pos + 1] << 8) | (uint8_t) str[pos + 2];
+}
+
+// distinct trigrams of a query
+static std::vector<uint32_t> query_trigrams(const std::string &query) {
+
+    std::vector<uint32_t> keys;
+    for (size_t i = 0; i + 2 < query.size(); i++) {
+        keys.push_back(trigram(query, i));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    return keys;
+}
+
+// query characters appear in order
+static bool subsequence(const std::string &text, const std::string &query) {
+
+    size_t pos = 0;
+    for (char c : query) {
+        pos = text.find(c, pos);
+        if (pos == std::string::npos) {
+            return false;
+        }
+        pos++;
+    }
+
+    return true;
+}
+
+std::string FilerSearch::fold(const std::string &str) {
+
+    std::string folded(str);
+    for (auto &c : folded) {
+        if (c >= 'A' && c <= 'Z') {
+            c = (char) (c - 'A' + 'a');
+        }
+    }
+
+    return folded;
+}
+
+void FilerSearch::clear() {
+
+    texts.clear();
+    trigrams.clear();
+    last_query.clear();
+    last_matches.clear();
+    built = false;
+}
+
+void FilerSearch::update(const FilerList &list) {
+
+    if (built && version == list.getVersion()) {
+        return;
+    }
+
+    clear();
+    texts.resize(list.size());
+    for (size_t i = 0; i < list.size(); i++) {
+        // name and title are split so no trigram spans both
+        texts[list.getId(i)] = fold(list.getName(i)) + '\n' + fold(list.getTitle(i));
+    }
+
+    // ids are visited in order, posting lists are sorted
+    for (uint32_t id = 0; id < texts.size(); id++) {
+        const std::string &text = texts[id];
+        for (size_t i = 0; i + 2 < text.size(); i++) {
+            if (text[i] == '\n' || text[i + 1] == '\n' || text[i + 2] == '\n') {
+                continue;
+            }
+            std::vector<uint32_t> &ids = trigrams[trigram(text, i)];
+            if (ids.empty() || ids.back() != id) {
+                ids.push_back(id);
+            }
+        }
+    }
+
+    version = list.getVersion();
+    built = true;
+}
+
+std::vector<size_t> FilerSearch::find(const FilerList &list, const std::string &query) {
+
+    std::vector<size_t> result;
+    std::string q = fold(query);
+
+    update(list);
+
+    if (q.empty()) {
+        last_query.clear();
+        last_matches.clear();
+        return result;
+    }
+
+    std::vector<uint32_t> matches;
+    if (!last_query.empty() && q.compare(0, last_query.size(), last_query) == 0) {
+        // refined query (typing): previous matches only
+        for (uint32_t id : last_matches) {
+            if (texts[id].find(q) != std::string::npos) {
+                matches.push_back(id);
+            }
+        }
+    } else if (q.size() >= 3) {
+        // rows containing all query trigrams, smallest list first
+        std::vector<const std::vector<uint32_t> *> lists;
+        for (uint32_t key : query_trigrams(q)) {
+            auto it = trigrams.find(key);
+            if (it == trigrams.end()) {
+                lists.clear();
+                break;
+            }
+            lists.push_back(&it->second);
+        }
+        if (!lists.empty()) {
+            std::sort(lists.begin(), lists.end(), [](const std::vector<uint32_t> *a, const std::vector<uint32_t> *b) {
+                return a->size() < b->size();
+            });
+            for (uint32_t id : *lists[0]) {
+                bool found = true;
+                for (size_t i = 1; i < lists.size() && found; i++) {
+                    found = std::binary_search(lists[i]->begin(), lists[i]->end(), id);
+                }
+                if (found && texts[id].find(q) != std::string::npos) {
+                    matches.push_back(id);
+                }
+            }
+        }
+    } else {
+        // one or two characters, plain scan
+        for (uint32_t id = 0; id < texts.size(); id++) {
+            if (texts[id].find(q) != std::string::npos) {
+                matches.push_back(id);
+            }
+        }
+    }
+
+    last_query = q;
+    last_matches = matches;
+
+    result.reserve(matches.size());
+    for (uint32_t id : matches) {
+        result.push_back(list.getIndex(id));
+    }
+    std::sort(result.begin(), result.end());
+
+    // then fuzzy matches, best first
+    std::vector<bool> exclude(texts.size(), false);
+    for (uint32_t id : matches) {
+        exclude[id] = true;
+    }
+    std::vector<std::pair<int, uint32_t>> scored;
+    fuzzy(q, exclude, &scored);
+    std::sort(scored.begin(), scored.end(), [&list](const std::pair<int, uint32_t> &a,
+                                                    const std::pair<int, uint32_t> &b) {
+        if (a.first != b.first) {
+            return a.first > b.first;
+        }
+        return list.getIndex(a.second) < list.getIndex(b.second);
+    });
+    for (auto &match : scored) {
+        result.push_back(list.getIndex(match.second));
+    }
+
+    return result;
+}
+
+void FilerSearch::fuzzy(const std::string &query, const std::vector<bool> &exclude,
+                        std::vector<std::pair<int, uint32_t>> *matches) {
+
+    // too short, everything would match
+    if (query.size() < 3) {
+        return;
+    }
+
+    // count shared trigrams per row
+    std::vector<uint16_t> counts;
+    std::vector<uint32_t> keys = query_trigrams(query);
+    if (keys.size() >= 3) {
+        counts.resize(texts.size(), 0);
+        for (uint32_t key : keys) {
+            auto it = trigrams.find(key);
+            if (it != trigrams.end()) {
+                for (uint32_t id : it->second) {
+                    counts[id]++;
+                }
+            }
+        }
+    }
+
+    auto threshold = (uint16_t) ((keys.size() + 1) / 2);
+    for (uint32_t id = 0; id < texts.size(); id++) {
+        if (exclude[id]) {
+            continue;
+        }
+        int score = 0;
+        if (!counts.empty() && counts[id] >= threshold) {
+            score += counts[id] * 2;
+        }
+        if (subsequence(texts[id], query)) {
+            score += 1;
+        }
+        if (score > 0) {
+            matches->emplace_back(score, id);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_FILER_SEARCH_H
+#define PPLAY_FILER_SEARCH_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "filer_list.h"
+
+// type-ahead search over the current filer listing (names and scrapped titles),
+// using a trigram index built once per listing (rows ids, not changed by sorting)
+class FilerSearch {
+
+public:
+
+    // (re)build index if list rows or titles changed
+    void update(const FilerList &list);
+
+    // matching list indices: substring matches in list order, then fuzzy matches
+    // (missing / wrong characters) by score. If query extends the previous one,
+    // only previous substring matches are searched.
+    std::vector<size_t> find(const FilerList &list, const std::string &query);
+
+    void clear();
+
+private:
+
+    static std::string fold(const std::string &str);
+
+    // score, row id of rows sharing most of query trigrams, or containing query characters in order
+    void fuzzy(const std::string &query, const std::vector<bool> &exclude,
+               std::vector<std::pair<int, uint32_t>> *matches);
+
+    // searched text by row id: folded name and title
+    std::vector<std::string> texts;
+    // trigram to sorted row ids
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams;
+    unsigned int version = 0;
+    bool built = false;
+    // last query substring matches (row ids)
+    std::string last_query;
+    std::vector<uint32_t> last_matches;
+};
+
+#endif //PPLAY_FILER_SEARCH_H
@@ -102,7 +102,7 @@ bool FilerSmb::getDir(const std::string &p) {
         for (size_t i = 0; smb_share_list[i] != nullptr; i++) {
             std::string name = smb_share_list[i];
             Io::File file(name, path + name, Io::Type::Directory, 0, COLOR_BLUE);
-            files.emplace_back(file, MediaInfo{});
+            files.add(file);
         }
         smb_share_list_destroy(smb_share_list);
         smb_session_destroy(smb_session);
@@ -155,9 +155,9 @@ bool FilerSmb::getDir(const std::string &p) {
                 Io::Type type = smb_stat_get(smb_st, SMB_STAT_ISDIR) ? Io::Type::Directory : Io::Type::File;
                 Io::File file(name, path + name, type, size);
                 printf("file.path: %s\n", file.path.c_str());
-                files.emplace_back(file, MediaInfo{});
+                files.add(file);
             }
-            std::sort(files.begin(), files.end(), Io::compare);
+            files.sort(0);
         }
         smb_stat_list_destroy(smb_files);
         smb_session_destroy(smb_session);
@@ -124,10 +124,17 @@ int net_read(int fd, char *buf, size_t len) {
     }
 }
 
+/// pplay
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+/// pplay
+
 int net_write(int fd, const char *buf, size_t len) {
     int done = 0;
     while (len > 0) {
-        int c = write(fd, buf, len);
+        /// pplay: no SIGPIPE when a pooled control connection was closed by the server
+        int c = send(fd, buf, len, MSG_NOSIGNAL);
         if (c == -1) {
             if (errno != EINTR && errno != EAGAIN)
                 return -1;
@@ -846,6 +853,12 @@ GLOBALDEF int FtpAccess(const char *path, int typ, int mode, netbuf *nControl,
             strcpy(buf, "LIST");
             dir = FTPLIB_READ;
             break;
+            /// pplay
+        case FTPLIB_DIR_MACHINE:
+            strcpy(buf, "MLSD");
+            dir = FTPLIB_READ;
+            break;
+            /// pplay
         case FTPLIB_FILE_READ:
             strcpy(buf, "RETR");
             dir = FTPLIB_READ;
@@ -966,6 +979,9 @@ GLOBALDEF int FtpClose(netbuf *nData) {
                 FtpClose(nData->data);
             }
             net_close(nData->handle);
+            /// pplay
+            free(nData->buf);
+            /// pplay
             free(nData);
             return 0;
     }
@@ -1156,44 +1172,127 @@ static int FtpXfer(const char *localfile, const char *path,
     return rv;
 }
 
-const std::vector<c2d::Io::File> FtpDirList(const char *p, netbuf *nControl) {
+/// pplay
+
+// MLSD line: "type=file;size=1024;modify=20190101120000; name"
+static int mlsd_parse(const std::string &line, std::string *name, c2d::Io::Type *type, size_t *size) {
+
+    size_t sep = line.find("; ");
+    if (sep == std::string::npos) {
+        // no facts
+        return 0;
+    }
+
+    *name = line.substr(sep + 2);
+    *type = c2d::Io::Type::Unknown;
+    *size = 0;
+
+    size_t pos = 0;
+    while (pos < sep) {
+        size_t end = line.find(';', pos);
+        if (end == std::string::npos || end > sep) {
+            end = sep;
+        }
+        std::string fact = line.substr(pos, end - pos);
+        for (auto &c : fact) {
+            c = (char) tolower((unsigned char) c);
+        }
+        if (fact.compare(0, 5, "type=") == 0) {
+            std::string value = fact.substr(5);
+            if (value == "file") {
+                *type = c2d::Io::Type::File;
+            } else if (value == "dir") {
+                *type = c2d::Io::Type::Directory;
+            } else if (value == "cdir" || value == "pdir") {
+                // current / parent directory
+                return 0;
+            }
+        } else if (fact.compare(0, 5, "size=") == 0 || fact.compare(0, 5, "sizd=") == 0) {
+            *size = (size_t) strtoull(fact.c_str() + 5, nullptr, 10);
+        }
+        pos = end + 1;
+    }
+
+    return *type != c2d::Io::Type::Unknown && !name->empty();
+}
+
+static void dirlist_parse(std::string &line, int typ, const std::string &url, std::vector<c2d::Io::File> *files) {
+
+    if (!line.empty() && line.back() == '\r') {
+        line.erase(line.size() - 1);
+    }
+    if (line.empty()) {
+        return;
+    }
+
+    std::string name;
+    c2d::Io::Type type;
+    size_t size;
+
+    if (typ == FTPLIB_DIR_MACHINE) {
+        if (!mlsd_parse(line, &name, &type, &size)) {
+            return;
+        }
+    } else {
+        struct ftpparse fp{};
+        if (ftpparse(&fp, &line[0], (int) line.size()) != 1) {
+            return;
+        }
+        if (fp.flagtrycwd && fp.flagtryretr) {
+            // skip links for now
+            return;
+        }
+        name.assign(fp.name, (size_t) fp.namelen);
+        type = fp.flagtrycwd == 1 ? c2d::Io::Type::Directory : c2d::Io::Type::File;
+        size = (size_t) fp.size;
+    }
+
+    if (name == "." || name == "..") {
+        return;
+    }
+
+    files->emplace_back(name, url + name, type, size);
+}
+
+int FtpDirList(const char *path, const char *url, int typ, netbuf *nControl, std::vector<c2d::Io::File> *files) {
 
     int len;
     char *buf;
     netbuf *nData;
-    struct ftpparse fp{};
-    std::vector<c2d::Io::File> files;
+    std::string prefix = url;
+    std::string pending;
+
+    if (!FtpAccess(path, typ, FTPLIB_ASCII, nControl, &nData)) {
+        return 0;
+    }
 
-    if (!FtpAccess(p, FTPLIB_DIR_VERBOSE, FTPLIB_ASCII, nControl, &nData)) {
-        return files;
+    if (!prefix.empty() && '/' != prefix.back()) {
+        prefix += "/";
     }
 
+    // reads may end in the middle of a line, only parse complete lines
     buf = static_cast<char *>(malloc(FTPLIB_BUFSIZ));
     while ((len = FtpRead(buf, FTPLIB_BUFSIZ, nData)) > 0) {
-        if (ftpparse(&fp, buf, len) == 1) {
-            if (fp.flagtrycwd && fp.flagtryretr) {
-                // skip links for now
-                continue;
-            }
-            std::string name = fp.name;
-            if (name.back() == '\n') {
-                name.erase(name.size() - 1);
-            }
-            std::string path = p;
-            if (!path.empty() && '/' != path.back()) {
-                path += "/";
-            }
-            c2d::Io::Type type = fp.flagtrycwd == 1 ? c2d::Io::Type::Directory : c2d::Io::Type::File;
-            files.emplace_back(name, path + name, type, fp.size);
+        pending.append(buf, (size_t) len);
+        size_t start = 0, end;
+        while ((end = pending.find('\n', start)) != std::string::npos) {
+            std::string line = pending.substr(start, end - start);
+            dirlist_parse(line, typ, prefix, files);
+            start = end + 1;
         }
+        pending.erase(0, start);
     }
+    // last line without line feed
+    dirlist_parse(pending, typ, prefix, files);
 
     free(buf);
-    FtpClose(nData);
 
-    return files;
+    // transfer complete (226)
+    return FtpClose(nData);
 }
 
+/// pplay
+
 /*
  * FtpNlst - issue an NLST command and write response to output
  *
@@ -43,6 +43,9 @@
 #define FTPLIB_DIR_VERBOSE 2
 #define FTPLIB_FILE_READ 3
 #define FTPLIB_FILE_WRITE 4
+/// pplay
+#define FTPLIB_DIR_MACHINE 5
+/// pplay
 
 /* FtpAccess() mode codes */
 #define FTPLIB_ASCII 'A'
@@ -119,7 +122,8 @@ GLOBALREF int FtpDelete(const char *fnm, netbuf *nControl);
 GLOBALREF void FtpQuit(netbuf *nControl);
 
 // pplay
-const std::vector<c2d::Io::File> FtpDirList(const char *path, netbuf *nControl);
+// list directory "path" (LIST or MLSD), files paths are "url/name". return 1 if successful, 0 otherwise
+int FtpDirList(const char *path, const char *url, int typ, netbuf *nControl, std::vector<c2d::Io::File> *files);
 
 #ifdef __cplusplus
 };
@@ -0,0 +1,131 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include <algorithm>
+
+#include "main.h"
+#include "media_loader.h"
+#include "utility.h"
+#include "p_search.h"
+
+// media info loaded per batch (one store lock), small enough to show visible rows quickly
+#define LOADER_BATCH 32
+
+using namespace pplay;
+
+static int load_thread(void *ptr) {
+
+    auto loader = (MediaLoader *) ptr;
+    auto main = loader->main;
+
+    while (true) {
+
+        SDL_LockMutex(loader->mutex);
+        while (loader->running && loader->jobs.empty()) {
+            SDL_CondWait(loader->cond, loader->mutex);
+        }
+        if (!loader->running) {
+            SDL_UnlockMutex(loader->mutex);
+            break;
+        }
+        size_t count = std::min(loader->jobs.size(), (size_t) LOADER_BATCH);
+        std::vector<c2d::Io::File> files(loader->jobs.begin(), loader->jobs.begin() + count);
+        loader->jobs.erase(loader->jobs.begin(), loader->jobs.begin() + count);
+        unsigned int generation = loader->generation;
+        SDL_UnlockMutex(loader->mutex);
+
+        std::vector<MediaInfo> mediaInfos = MediaInfo::load(files);
+        for (size_t i = 0; i < files.size(); i++) {
+            MediaLoader::Result result;
+            result.file = files[i];
+            result.mediaInfo = std::move(mediaInfos[i]);
+            std::string scrapPath = pplay::Utility::getMediaScrapPath(result.file);
+            if (main->getIo()->exist(scrapPath)) {
+                pscrap::Search search;
+                search.load(scrapPath);
+                if (search.total_results > 0) {
+                    result.movies = search.movies;
+                }
+            }
+
+            SDL_LockMutex(loader->mutex);
+            bool current = loader->running && generation == loader->generation;
+            if (current) {
+                loader->results.emplace_back(std::move(result));
+            }
+            SDL_UnlockMutex(loader->mutex);
+            if (!current) {
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+MediaLoader::MediaLoader(Main *m) {
+
+    main = m;
+    mutex = SDL_CreateMutex();
+    cond = SDL_CreateCond();
+    thread = SDL_CreateThread(load_thread, "load_thread", (void *) this);
+}
+
+void MediaLoader::load(const std::vector<c2d::Io::File> &files) {
+
+    SDL_LockMutex(mutex);
+    generation++;
+    jobs.clear();
+    results.clear();
+    jobs.insert(jobs.end(), files.begin(), files.end());
+    SDL_UnlockMutex(mutex);
+
+    SDL_CondSignal(cond);
+}
+
+void MediaLoader::add(const std::vector<c2d::Io::File> &files) {
+
+    SDL_LockMutex(mutex);
+    jobs.insert(jobs.end(), files.begin(), files.end());
+    SDL_UnlockMutex(mutex);
+
+    SDL_CondSignal(cond);
+}
+
+void MediaLoader::prioritize(const std::vector<std::string> &paths) {
+
+    SDL_LockMutex(mutex);
+    std::stable_partition(jobs.begin(), jobs.end(), [&paths](const c2d::Io::File &file) {
+        return std::find(paths.begin(), paths.end(), file.path) != paths.end();
+    });
+    SDL_UnlockMutex(mutex);
+}
+
+int MediaLoader::poll(const Callback &callback) {
+
+    std::vector<Result> done;
+
+    SDL_LockMutex(mutex);
+    done.swap(results);
+    SDL_UnlockMutex(mutex);
+
+    for (auto &result : done) {
+        callback(result);
+    }
+
+    return (int) done.size();
+}
+
+MediaLoader::~MediaLoader() {
+
+    SDL_LockMutex(mutex);
+    running = false;
+    jobs.clear();
+    SDL_UnlockMutex(mutex);
+    SDL_CondSignal(cond);
+
+    SDL_WaitThread(thread, nullptr);
+    SDL_DestroyCond(cond);
+    SDL_DestroyMutex(mutex);
+}
@@ -0,0 +1,65 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_MEDIA_LOADER_H
+#define PPLAY_MEDIA_LOADER_H
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include <SDL2/SDL_thread.h>
+
+#include "cross2d/skeleton/io.h"
+#include "media_info.h"
+#include "p_movie.h"
+
+class Main;
+
+namespace pplay {
+
+    // loads cached media information and scrap data of a directory listing
+    // in background, so the filer can show file names immediately
+    class MediaLoader {
+
+    public:
+
+        class Result {
+        public:
+            c2d::Io::File file;
+            MediaInfo mediaInfo;
+            std::vector<pscrap::Movie> movies;
+        };
+
+        typedef std::function<void(Result &result)> Callback;
+
+        explicit MediaLoader(Main *main);
+
+        ~MediaLoader();
+
+        // new directory: drop pending jobs and results of the previous one
+        void load(const std::vector<c2d::Io::File> &files);
+
+        // append to pending jobs (reload of rows dropped from filer cache)
+        void add(const std::vector<c2d::Io::File> &files);
+
+        // move pending jobs of these files (visible rows) to the front of the queue
+        void prioritize(const std::vector<std::string> &paths);
+
+        // call from ui thread, returns results count
+        int poll(const Callback &callback);
+
+        Main *main;
+        std::deque<c2d::Io::File> jobs;
+        std::vector<Result> results;
+        // incremented on each load, results of an old listing are dropped
+        unsigned int generation = 0;
+        SDL_mutex *mutex = nullptr;
+        SDL_cond *cond = nullptr;
+        SDL_Thread *thread = nullptr;
+        bool running = true;
+    };
+}
+
+#endif //PPLAY_MEDIA_LOADER_H
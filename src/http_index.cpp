@@ -0,0 +1,882 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include "http_index.h"
+
+using namespace pplay;
+
+// longest tag kept (attributes), longer ones are truncated
+#define TAG_MAX 4096
+// longest text kept after an anchor (size, date columns)
+#define COLUMNS_MAX 512
+
+static int hex_value(char c) {
+
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f';
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static char to_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char) (c + 32) : c;
+}
+
+static void append_utf8(std::string *out, uint32_t code) {
+
+    if (code < 0x80) {
+        *out += (char) code;
+    } else if (code < 0x800) {
+        *out += (char) (0xC0 | (code >> 6));
+        *out += (char) (0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        *out += (char) (0xE0 | (code >> 12));
+        *out += (char) (0x80 | ((code >> 6) & 0x3F));
+        *out += (char) (0x80 | (code & 0x3F));
+    } else {
+        *out += (char) (0xF0 | (code >> 18));
+        *out += (char) (0x80 | ((code >> 12) & 0x3F));
+        *out += (char) (0x80 | ((code >> 6) & 0x3F));
+        *out += (char) (0x80 | (code & 0x3F));
+    }
+}
+
+// "&amp;", "&#39;", "&#x27;"..
+static std::string decode_entities(const std::string &str) {
+
+    if (str.find('&') == std::string::npos) {
+        return str;
+    }
+
+    std::string out;
+    out.reserve(str.size());
+    for (size_t i = 0; i < str.size(); i++) {
+        size_t end;
+        if (str[i] != '&' || (end = str.find(';', i)) == std::string::npos || end - i > 10) {
+            out += str[i];
+            continue;
+        }
+        std::string name = str.substr(i + 1, end - i - 1);
+        long code = -1;
+        if (name == "amp") code = '&';
+        else if (name == "lt") code = '<';
+        else if (name == "gt") code = '>';
+        else if (name == "quot") code = '"';
+        else if (name == "apos") code = '\'';
+        else if (name == "nbsp") code = ' ';
+        else if (name.size() > 1 && name[0] == '#') {
+            bool hex = name[1] == 'x' || name[1] == 'X';
+            char *stop = nullptr;
+            code = strtol(name.c_str() + (hex ? 2 : 1), &stop, hex ? 16 : 10);
+            if (!stop || *stop != '\0') code = -1;
+        }
+        if (code < 0 || code > 0x10FFFF) {
+            out += str[i];
+            continue;
+        }
+        append_utf8(&out, (uint32_t) code);
+        i = end;
+    }
+
+    return out;
+}
+
+static std::string decode_percent(const std::string &str) {
+
+    if (str.find('%') == std::string::npos) {
+        return str;
+    }
+
+    std::string out;
+    out.reserve(str.size());
+    for (size_t i = 0; i < str.size(); i++) {
+        int hi, lo;
+        if (str[i] == '%' && i + 2 < str.size()
+            && (hi = hex_value(str[i + 1])) >= 0 && (lo = hex_value(str[i + 2])) >= 0) {
+            out += (char) (hi << 4 | lo);
+            i += 2;
+        } else {
+            out += str[i];
+        }
+    }
+
+    return out;
+}
+
+// value of attribute "name" in tag (lower case name, without "<>"), false if not found
+static bool get_attribute(const std::string &tag, const char *name, std::string *value) {
+
+    size_t len = strlen(name);
+    size_t i = 0;
+
+    // skip tag name
+    while (i < tag.size() && !is_space(tag[i])) i++;
+
+    while (i < tag.size()) {
+        while (i < tag.size() && (is_space(tag[i]) || tag[i] == '/')) i++;
+        size_t start = i;
+        while (i < tag.size() && !is_space(tag[i]) && tag[i] != '=') i++;
+        bool match = i - start == len;
+        for (size_t j = 0; match && j < len; j++) {
+            match = to_lower(tag[start + j]) == name[j];
+        }
+        while (i < tag.size() && is_space(tag[i])) i++;
+        if (i >= tag.size() || tag[i] != '=') {
+            if (match) {
+                value->clear();
+                return true;
+            }
+            continue;
+        }
+        i++;
+        while (i < tag.size() && is_space(tag[i])) i++;
+        size_t end;
+        if (i < tag.size() && (tag[i] == '"' || tag[i] == '\'')) {
+            end = tag.find(tag[i], i + 1);
+            if (end == std::string::npos) end = tag.size();
+            start = i + 1;
+            i = end + 1;
+        } else {
+            start = i;
+            while (i < tag.size() && !is_space(tag[i])) i++;
+            end = i;
+        }
+        if (match) {
+            *value = decode_entities(tag.substr(start, end - start));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// listed entry name from a link (relative, absolute or full url), false if not a child of "base"
+static bool get_name(std::string href, const std::string &base, std::string *name, bool *directory) {
+
+    // sorting links (apache "?C=N;O=D"), anchors
+    if (href.empty() || href.find('?') != std::string::npos || href[0] == '#') {
+        return false;
+    }
+    size_t scheme = href.find("://");
+    if (scheme != std::string::npos) {
+        size_t slash = href.find('/', scheme + 3);
+        href = slash == std::string::npos ? "/" : href.substr(slash);
+    }
+    href = decode_percent(href);
+    if (href[0] == '/') {
+        // absolute, must be a child of the listed directory
+        if (href.size() <= base.size() || href.compare(0, base.size(), base) != 0) {
+            return false;
+        }
+        href = href.substr(base.size());
+    } else if (href.compare(0, 2, "./") == 0) {
+        href = href.substr(2);
+    }
+    *directory = !href.empty() && href.back() == '/';
+    if (*directory) {
+        href.pop_back();
+    }
+    // parent, self, deeper paths
+    if (href.empty() || href == "." || href == ".." || href.find('/') != std::string::npos) {
+        return false;
+    }
+
+    *name = href;
+    return true;
+}
+
+// tag name without namespace prefix ("/D:href" > "/href"), lower case. false if longer than "max"
+static bool get_tag_name(const std::string &tag, char *name, size_t max) {
+
+    size_t len = 0, i = 0;
+
+    if (!tag.empty() && tag[0] == '/') {
+        name[len++] = '/';
+        i++;
+    }
+    for (; i < tag.size() && !is_space(tag[i]) && !(tag[i] == '/' && i > 0); i++) {
+        if (tag[i] == ':') {
+            len = name[0] == '/' ? 1 : 0;
+            continue;
+        }
+        if (len >= max - 1) {
+            return false;
+        }
+        name[len++] = to_lower(tag[i]);
+    }
+    name[len] = '\0';
+
+    return true;
+}
+
+// days since 1970-01-01 (proleptic gregorian)
+static int64_t days_from_civil(int64_t y, int m, int d) {
+
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static int parse_month(const char *str, size_t len) {
+
+    static const char *months = "janfebmaraprmayjunjulaugsepoctnovdec";
+
+    if (len != 3) {
+        return 0;
+    }
+    for (int i = 0; i < 12; i++) {
+        if (to_lower(str[0]) == months[i * 3] && to_lower(str[1]) == months[i * 3 + 1]
+            && to_lower(str[2]) == months[i * 3 + 2]) {
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+static bool parse_number(const char *str, size_t len, int *value) {
+
+    if (len == 0 || len > 4) {
+        return false;
+    }
+    *value = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (!is_digit(str[i])) return false;
+        *value = *value * 10 + (str[i] - '0');
+    }
+
+    return true;
+}
+
+// "2026-10-17", "17-Oct-2026", "2026-Oct-17", returns days since epoch or -1
+static int64_t parse_date(const char *str, size_t len) {
+
+    const char *parts[3];
+    size_t sizes[3];
+    size_t count = 0, start = 0;
+
+    for (size_t i = 0; i <= len && count < 3; i++) {
+        if (i == len || str[i] == '-') {
+            parts[count] = str + start;
+            sizes[count++] = i - start;
+            start = i + 1;
+        }
+    }
+    if (count != 3 || start <= len) {
+        return -1;
+    }
+
+    int year, month, day;
+    if (sizes[0] == 4 && parse_number(parts[0], 4, &year)) {
+        month = parse_month(parts[1], sizes[1]);
+        if (!month && !parse_number(parts[1], sizes[1], &month)) return -1;
+        if (!parse_number(parts[2], sizes[2], &day)) return -1;
+    } else if (sizes[2] == 4 && parse_number(parts[2], 4, &year)) {
+        month = parse_month(parts[1], sizes[1]);
+        if (!month && !parse_number(parts[1], sizes[1], &month)) return -1;
+        if (!parse_number(parts[0], sizes[0], &day)) return -1;
+    } else {
+        return -1;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31) {
+        return -1;
+    }
+
+    return days_from_civil(year, month, day);
+}
+
+// "10:00", "10:00:00", returns seconds or -1
+static int64_t parse_time(const char *str, size_t len) {
+
+    int h, m, s = 0;
+
+    if (len < 5 || str[2] != ':' || !parse_number(str, 2, &h) || !parse_number(str + 3, 2, &m)) {
+        return -1;
+    }
+    if (len >= 8 && str[5] == ':' && !parse_number(str + 6, 2, &s)) {
+        return -1;
+    }
+
+    return h * 3600 + m * 60 + s;
+}
+
+// "2026-10-17T10:00:00Z", "2026-10-17T10:00:00.123+02:00"
+static int64_t parse_datetime(const std::string &str) {
+
+    size_t t = str.find('T');
+    if (t == std::string::npos) {
+        t = str.find(' ');
+    }
+    if (t == std::string::npos) {
+        return 0;
+    }
+    int64_t days = parse_date(str.c_str(), t);
+    int64_t secs = parse_time(str.c_str() + t + 1, str.size() - t - 1);
+    if (days < 0 || secs < 0) {
+        return 0;
+    }
+
+    int64_t time = days * 86400 + secs;
+    size_t zone = str.find_first_of("+-Z", t + 1);
+    if (zone != std::string::npos && str[zone] != 'Z') {
+        int h, m = 0;
+        const char *z = str.c_str() + zone + 1;
+        size_t left = str.size() - zone - 1;
+        if (left >= 2 && parse_number(z, 2, &h)) {
+            if (left >= 5 && z[2] == ':') parse_number(z + 3, 2, &m);
+            else if (left >= 4) parse_number(z + 2, 2, &m);
+            int64_t offset = h * 3600 + m * 60;
+            time += str[zone] == '+' ? -offset : offset;
+        }
+    }
+
+    return time;
+}
+
+// iso 8601 (above) or rfc 1123 ("Fri, 17 Oct 2026 10:00:00 GMT"), 0 if unknown
+static int64_t parse_http_date(const std::string &str) {
+
+    int64_t time = parse_datetime(str);
+    if (time) {
+        return time;
+    }
+
+    int day, year;
+    char month[4], clock[9];
+    size_t comma = str.find(',');
+    const char *start = str.c_str() + (comma == std::string::npos ? 0 : comma + 1);
+    if (sscanf(start, "%2d %3s %4d %8s", &day, month, &year, clock) != 4) {
+        return 0;
+    }
+    int m = parse_month(month, strlen(month));
+    int64_t secs = parse_time(clock, strlen(clock));
+    if (!m || secs < 0 || day < 1 || day > 31) {
+        return 0;
+    }
+
+    return days_from_civil(year, m, day) * 86400 + secs;
+}
+
+// "1234", "1.2M", "1.2K", "12 MiB", "3.1GB", returns bytes or -1.
+// "unit" is the following token (detached unit), set if used
+static int64_t parse_size(const char *str, size_t len, const char *unit, size_t unit_len, bool *used) {
+
+    size_t i = 0;
+    double value = 0;
+    bool digits = false;
+
+    *used = false;
+    while (i < len && is_digit(str[i])) {
+        value = value * 10 + (str[i++] - '0');
+        digits = true;
+    }
+    if (i < len && (str[i] == '.' || str[i] == ',')) {
+        double scale = 0.1;
+        for (i++; i < len && is_digit(str[i]); i++) {
+            value += (str[i] - '0') * scale;
+            scale /= 10;
+            digits = true;
+        }
+    }
+    if (!digits) {
+        return -1;
+    }
+
+    const char *suffix = str + i;
+    size_t suffix_len = len - i;
+    if (!suffix_len && unit && unit_len > 0 && unit_len <= 3) {
+        suffix = unit;
+        suffix_len = unit_len;
+        *used = true;
+    }
+    if (!suffix_len) {
+        return (int64_t) value;
+    }
+
+    // K, KB, KiB, bytes
+    int shift;
+    switch (to_lower(suffix[0])) {
+        case 'b':
+            shift = 0;
+            break;
+        case 'k':
+            shift = 10;
+            break;
+        case 'm':
+            shift = 20;
+            break;
+        case 'g':
+            shift = 30;
+            break;
+        case 't':
+            shift = 40;
+            break;
+        default:
+            *used = false;
+            return -1;
+    }
+    if (shift > 0 && suffix_len > 1) {
+        size_t j = 1;
+        if (to_lower(suffix[j]) == 'i') j++;
+        if (j < suffix_len && to_lower(suffix[j]) == 'b') j++;
+        if (j != suffix_len) {
+            *used = false;
+            return -1;
+        }
+    }
+
+    return (int64_t) (value * (double) (1ULL << shift));
+}
+
+HttpIndex::HttpIndex(const std::string &path, Format format) {
+
+    this->format = format;
+    xml = format == Format::Dav;
+    base = decode_percent(path);
+    if (base.empty() || base.back() != '/') {
+        base += '/';
+    }
+}
+
+size_t HttpIndex::write(char *data, size_t size, size_t count, void *userdata) {
+
+    ((HttpIndex *) userdata)->feed(data, size * count);
+    return size * count;
+}
+
+void HttpIndex::feed(const char *data, size_t size) {
+
+    const char *end = data + size;
+
+    // json ("[" or "{") or markup
+    while (state == State::Start && data < end) {
+        if (is_space(*data) || (unsigned char) *data >= 0x80) {
+            // white spaces, utf-8 bom
+            data++;
+        } else {
+            state = *data == '[' || *data == '{' ? State::Json : State::Text;
+        }
+    }
+
+    if (state == State::Json) {
+        feedJson(data, (size_t) (end - data));
+        return;
+    }
+
+    while (data < end) {
+        if (state == State::Text) {
+            auto lt = (const char *) memchr(data, '<', (size_t) (end - data));
+            if (!lt) {
+                onText(data, (size_t) (end - data));
+                return;
+            }
+            if (lt > data) {
+                onText(data, (size_t) (lt - data));
+            }
+            data = lt + 1;
+            state = State::Tag;
+            quote = 0;
+            tag.clear();
+            continue;
+        }
+
+        // inside tag, until an unquoted '>'
+        const char *start = data;
+        for (; data < end; data++) {
+            char c = *data;
+            if (quote) {
+                if (c == quote) quote = 0;
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+            } else if (c == '>') {
+                break;
+            }
+        }
+        if (tag.size() < TAG_MAX) {
+            tag.append(start, std::min((size_t) (data - start), TAG_MAX - tag.size()));
+        }
+        if (data < end) {
+            data++;
+            state = State::Text;
+            onTag();
+        }
+    }
+}
+
+void HttpIndex::finish() {
+
+    if (state == State::Tag) {
+        state = State::Text;
+        onTag();
+    }
+    flush();
+}
+
+void HttpIndex::onText(const char *data, size_t size) {
+
+    if (xml) {
+        if (capture != Capture::None && text.size() < TAG_MAX) {
+            text.append(data, std::min(size, TAG_MAX - text.size()));
+        }
+        return;
+    }
+
+    // anchor text is ignored (may be truncated by the server, use href)
+    if (!pending || anchor) {
+        return;
+    }
+
+    // preformatted listings (nginx, apache): one entry per line
+    if (pre) {
+        auto nl = (const char *) memchr(data, '\n', size);
+        if (nl) {
+            onText(data, (size_t) (nl - data));
+            flush();
+            return;
+        }
+    }
+
+    if (columns.size() < COLUMNS_MAX) {
+        columns.append(data, std::min(size, COLUMNS_MAX - columns.size()));
+    }
+}
+
+void HttpIndex::onTag() {
+
+    char name[24];
+    if (!get_tag_name(tag, name, sizeof(name))) {
+        // longer tag name, not one of ours
+        return;
+    }
+
+    // nginx xml autoindex root
+    if (!xml && !strcmp(name, "list") && entries.empty() && !pending) {
+        xml = true;
+    }
+
+    if (xml) {
+        onXmlTag(name);
+    } else {
+        onHtmlTag(name);
+    }
+}
+
+void HttpIndex::onXmlTag(const char *name) {
+
+    std::string value;
+    bool close = name[0] == '/';
+    const char *local = close ? name + 1 : name;
+
+    if (format == Format::Dav) {
+        // <response><href/><propstat><prop><getcontentlength/><getlastmodified/><resourcetype><collection/>..
+        if (!strcmp(local, "response")) {
+            if (close) {
+                bool directory = false;
+                std::string href = entry.name;
+                if (get_name(href, base, &entry.name, &directory)) {
+                    entry.directory = entry.directory || directory;
+                    push();
+                }
+            }
+            entry = Entry();
+        } else if (!strcmp(local, "collection") && !close) {
+            entry.directory = true;
+        } else if (!strcmp(local, "href") || !strcmp(local, "getcontentlength")
+                   || !strcmp(local, "getlastmodified")) {
+            if (!close) {
+                capture = local[3] == 'c' ? Capture::Size : local[3] == 'l' ? Capture::Time : Capture::Href;
+                text.clear();
+                return;
+            }
+            value = decode_entities(text);
+            if (capture == Capture::Href) {
+                // first href only (some servers add more in propstat errors)
+                if (entry.name.empty()) {
+                    entry.name = value;
+                }
+            } else if (capture == Capture::Size) {
+                entry.size = (size_t) strtoull(value.c_str(), nullptr, 10);
+            } else if (capture == Capture::Time) {
+                entry.mtime = parse_http_date(value);
+            }
+            capture = Capture::None;
+        }
+        return;
+    }
+
+    // nginx: <directory mtime="..">name</directory><file mtime=".." size="..">name</file>
+    if (!strcmp(local, "file") || !strcmp(local, "directory")) {
+        if (!close) {
+            entry = Entry();
+            entry.directory = local[0] == 'd';
+            if (get_attribute(tag, "size", &value)) {
+                entry.size = (size_t) strtoull(value.c_str(), nullptr, 10);
+            }
+            if (get_attribute(tag, "mtime", &value)) {
+                entry.mtime = parse_http_date(value);
+            }
+            capture = Capture::Name;
+            text.clear();
+            return;
+        }
+        entry.name = decode_entities(text);
+        capture = Capture::None;
+        push();
+    }
+}
+
+void HttpIndex::onHtmlTag(const char *name) {
+
+    if (!strcmp(name, "a")) {
+        std::string href, child;
+        bool directory;
+        if (!get_attribute(tag, "href", &href) || !get_name(href, base, &child, &directory)) {
+            return;
+        }
+        // same entry linked twice (icon and name)
+        if (pending && entry.name == child) {
+            anchor = true;
+            return;
+        }
+        flush();
+        entry.name = child;
+        entry.directory = directory;
+        pending = anchor = true;
+    } else if (!strcmp(name, "/a")) {
+        anchor = false;
+    } else if (!strcmp(name, "pre")) {
+        flush();
+        pre = true;
+    } else if (!strcmp(name, "/pre")) {
+        flush();
+        pre = false;
+    } else if (!strcmp(name, "tr") || !strcmp(name, "/tr") || !strcmp(name, "/table")) {
+        flush();
+    } else if (pending && !anchor) {
+        std::string value;
+        if (!strcmp(name, "td") && get_attribute(tag, "data-order", &value)) {
+            // caddy, exact size ("-1" for directories)
+            char *stop = nullptr;
+            long long order_value = strtoll(value.c_str(), &stop, 10);
+            if (stop && *stop == '\0' && order_value >= 0) {
+                order = order_value;
+            }
+        } else if (!strcmp(name, "time") && get_attribute(tag, "datetime", &value)) {
+            datetime = parse_datetime(value);
+        }
+        // cells separator
+        if (columns.size() < COLUMNS_MAX) {
+            columns += ' ';
+        }
+    }
+}
+
+void HttpIndex::feedJson(const char *data, size_t size) {
+
+    // array of objects, nginx: {"name", "type", "mtime", "size"},
+    // caddy: {"name", "size", "url", "mod_time", "mode", "is_dir", "is_symlink"}
+    for (size_t i = 0; i < size; i++) {
+        char c = data[i];
+
+        if (in_string) {
+            if (unicode >= 0) {
+                int digit = hex_value(c);
+                code = (code << 4) | (uint32_t) (digit < 0 ? 0 : digit);
+                if (++unicode < 4) {
+                    continue;
+                }
+                unicode = -1;
+                if (code >= 0xD800 && code < 0xDC00) {
+                    surrogate = code;
+                    continue;
+                }
+                if (code >= 0xDC00 && code < 0xE000 && surrogate) {
+                    code = 0x10000 + ((surrogate - 0xD800) << 10) + (code - 0xDC00);
+                }
+                surrogate = 0;
+                if (value.size() < TAG_MAX) append_utf8(&value, code);
+            } else if (escape) {
+                escape = false;
+                if (c == 'u') {
+                    unicode = 0;
+                    code = 0;
+                    continue;
+                }
+                char unescaped = c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r'
+                                                                    : c == 'b' ? '\b' : c == 'f' ? '\f' : c;
+                if (value.size() < TAG_MAX) value += unescaped;
+            } else if (c == '\\') {
+                escape = true;
+            } else if (c == '"') {
+                in_string = false;
+                onJsonValue(true);
+            } else {
+                // plain characters run
+                size_t start = i;
+                while (i + 1 < size && data[i + 1] != '"' && data[i + 1] != '\\') i++;
+                if (value.size() < TAG_MAX) {
+                    value.append(data + start, std::min(i + 1 - start, TAG_MAX - value.size()));
+                }
+            }
+            continue;
+        }
+
+        switch (c) {
+            case '"':
+                in_string = true;
+                value.clear();
+                break;
+            case '{':
+            case '[':
+                onJsonValue(false);
+                if (c == '{' && stack.size() <= 1) {
+                    entry = Entry();
+                }
+                stack += c;
+                in_key = c == '{';
+                break;
+            case '}':
+            case ']':
+                onJsonValue(false);
+                if (!stack.empty()) {
+                    stack.pop_back();
+                }
+                if (c == '}' && stack.size() <= 1) {
+                    push();
+                }
+                break;
+            case ',':
+                onJsonValue(false);
+                in_key = !stack.empty() && stack.back() == '{';
+                break;
+            case ':':
+                in_key = false;
+                break;
+            default:
+                // number, true, false, null
+                if (!is_space(c) && value.size() < 32) {
+                    value += c;
+                }
+                break;
+        }
+    }
+}
+
+void HttpIndex::onJsonValue(bool string) {
+
+    if (!string && value.empty()) {
+        return;
+    }
+
+    if (in_key) {
+        key = value;
+    } else if (!stack.empty() && stack.back() == '{' && stack.size() <= 2) {
+        if (key == "name" && string) {
+            entry.name = value;
+        } else if (key == "type" && string) {
+            entry.directory = value == "directory";
+        } else if (key == "is_dir") {
+            entry.directory = value == "true";
+        } else if (key == "size" && !string) {
+            entry.size = (size_t) strtoull(value.c_str(), nullptr, 10);
+        } else if ((key == "mtime" || key == "mod_time") && string) {
+            entry.mtime = parse_http_date(value);
+        }
+    }
+
+    value.clear();
+}
+
+void HttpIndex::push() {
+
+    // caddy directories have a trailing slash
+    if (!entry.name.empty() && entry.name.back() == '/') {
+        entry.name.pop_back();
+        entry.directory = true;
+    }
+    if (entry.name.empty() || entry.name == "." || entry.name == ".."
+        || entry.name.find('/') != std::string::npos) {
+        entry = Entry();
+        return;
+    }
+    if (entry.directory) {
+        entry.size = 0;
+    }
+
+    entries.push_back(entry);
+    entry = Entry();
+}
+
+void HttpIndex::flush() {
+
+    if (!pending) {
+        return;
+    }
+
+    std::string text = decode_entities(columns);
+    const char *tokens[16];
+    size_t sizes[16];
+    size_t count = 0;
+    for (size_t i = 0; i < text.size() && count < 16;) {
+        while (i < text.size() && is_space(text[i])) i++;
+        size_t start = i;
+        while (i < text.size() && !is_space(text[i])) i++;
+        if (i > start) {
+            tokens[count] = text.c_str() + start;
+            sizes[count++] = i - start;
+        }
+    }
+
+    // date (and time) columns, then the first size looking column
+    int64_t mtime = datetime;
+    int64_t size = order;
+    for (size_t i = 0; i < count; i++) {
+        int64_t days = parse_date(tokens[i], sizes[i]);
+        if (days >= 0) {
+            int64_t secs = i + 1 < count ? parse_time(tokens[i + 1], sizes[i + 1]) : -1;
+            if (secs >= 0) {
+                i++;
+            }
+            if (!mtime) {
+                mtime = days * 86400 + (secs > 0 ? secs : 0);
+            }
+            continue;
+        }
+        if (parse_time(tokens[i], sizes[i]) >= 0) {
+            continue;
+        }
+        if (size < 0 && !entry.directory) {
+            bool used;
+            size = parse_size(tokens[i], sizes[i],
+                              i + 1 < count ? tokens[i + 1] : nullptr, i + 1 < count ? sizes[i + 1] : 0, &used);
+            if (used) {
+                i++;
+            }
+        }
+    }
+
+    entry.size = size > 0 && !entry.directory ? (size_t) size : 0;
+    entry.mtime = mtime;
+    entries.push_back(entry);
+
+    pending = anchor = false;
+    columns.clear();
+    order = -1;
+    datetime = 0;
+}
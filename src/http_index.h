@@ -0,0 +1,113 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_HTTP_INDEX_H
+#define PPLAY_HTTP_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pplay {
+
+    // incremental parser of http server directory listings, fed with received data
+    // as it arrives (curl write callback): html "autoindex" pages (apache, nginx, lighttpd, caddy),
+    // nginx json / xml autoindex, caddy json browse and webdav PROPFIND (207 multistatus).
+    // Only entries fields are kept, the page is never buffered.
+    class HttpIndex {
+
+    public:
+
+        enum class Format {
+            // html, nginx json / xml or caddy json (detected)
+            Auto,
+            // webdav multistatus
+            Dav
+        };
+
+        class Entry {
+        public:
+            // decoded name (no trailing slash)
+            std::string name;
+            bool directory = false;
+            // from listing columns, 0 if unknown
+            size_t size = 0;
+            int64_t mtime = 0;
+        };
+
+        // "path": listing url path (absolute links to sub entries are accepted)
+        explicit HttpIndex(const std::string &path = "/", Format format = Format::Auto);
+
+        void feed(const char *data, size_t size);
+
+        // end of page, flush last entry
+        void finish();
+
+        // curl write callback, "userdata" is a HttpIndex
+        static size_t write(char *data, size_t size, size_t count, void *userdata);
+
+        std::vector<Entry> entries;
+
+    private:
+
+        enum class State {
+            Start, Text, Tag, Json
+        };
+
+        // xml element text being captured
+        enum class Capture {
+            None, Name, Href, Size, Time
+        };
+
+        void onTag();
+
+        void onHtmlTag(const char *name);
+
+        void onXmlTag(const char *name);
+
+        void onText(const char *data, size_t size);
+
+        void feedJson(const char *data, size_t size);
+
+        void onJsonValue(bool string);
+
+        // end of current entry columns
+        void flush();
+
+        // add current entry (xml, json)
+        void push();
+
+        Format format;
+        State state = State::Start;
+        char quote = 0;
+        std::string tag;
+        std::string base;
+        // current entry (href found) and its columns text
+        Entry entry;
+        bool pending = false;
+        bool anchor = false;
+        bool pre = false;
+        std::string columns;
+        // exact size from attributes (caddy)
+        int64_t order = -1;
+        int64_t datetime = 0;
+        // xml (nginx, webdav)
+        bool xml = false;
+        Capture capture = Capture::None;
+        std::string text;
+        // json: containers stack, current key, string / literal being read
+        std::string stack;
+        std::string key;
+        bool in_key = false;
+        bool in_string = false;
+        bool escape = false;
+        // "\u" escape digits read, high surrogate
+        int unicode = -1;
+        uint32_t code = 0;
+        uint32_t surrogate = 0;
+        std::string value;
+    };
+}
+
+#endif //PPLAY_HTTP_INDEX_H
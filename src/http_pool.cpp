@@ -0,0 +1,198 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include "cross2d/c2d.h"
+#include "http_pool.h"
+
+// idle easy handles kept, each one keeping its own alive connections
+#define HTTP_IDLE_MAX 8
+// print reuse stats every n requests
+#define HTTP_STATS_EVERY 100
+
+using namespace pplay;
+
+HttpPool::HttpPool() {
+
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    mutex = SDL_CreateMutex();
+    for (auto &l : locks) {
+        l = SDL_CreateMutex();
+    }
+
+    share = curl_share_init();
+    if (share) {
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lock);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlock);
+        curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        // no CURL_LOCK_DATA_CONNECT: a shared connection cache is not supported with
+        // concurrent transfers (scan workers, probers), connections stay in pooled handles
+    }
+}
+
+HttpPool *HttpPool::getInstance() {
+    static HttpPool pool;
+    return &pool;
+}
+
+void HttpPool::lock(CURL *curl, curl_lock_data data, curl_lock_access access, void *userdata) {
+    SDL_LockMutex(((HttpPool *) userdata)->locks[data]);
+}
+
+void HttpPool::unlock(CURL *curl, curl_lock_data data, void *userdata) {
+    SDL_UnlockMutex(((HttpPool *) userdata)->locks[data]);
+}
+
+CURL *HttpPool::acquire() {
+
+    CURL *curl = nullptr;
+
+    SDL_LockMutex(mutex);
+    if (!handles.empty()) {
+        curl = handles.back();
+        handles.pop_back();
+    }
+    SDL_UnlockMutex(mutex);
+
+    if (!curl) {
+        curl = curl_easy_init();
+        if (!curl) {
+            return nullptr;
+        }
+    }
+
+    if (share) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    }
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    return curl;
+}
+
+void HttpPool::release(CURL *curl) {
+
+    if (!curl) {
+        return;
+    }
+
+    // options are reset, the handle keeps its connections alive
+    curl_easy_reset(curl);
+
+    SDL_LockMutex(mutex);
+    if (handles.size() < HTTP_IDLE_MAX) {
+        handles.push_back(curl);
+        curl = nullptr;
+    }
+    SDL_UnlockMutex(mutex);
+
+    if (curl) {
+        curl_easy_cleanup(curl);
+    }
+}
+
+CURLcode HttpPool::perform(CURL *curl) {
+
+    CURLcode res = curl_easy_perform(curl);
+
+    long connects = 0;
+    double connect = 0, appconnect = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME, &appconnect);
+
+    SDL_LockMutex(mutex);
+    stats.requests++;
+    if (res == CURLE_OK && connects == 0) {
+        stats.reused++;
+    }
+    stats.connects += (int) connects;
+    if (connects > 0) {
+        stats.connectTime += appconnect > connect ? appconnect : connect;
+    }
+    if (stats.requests % HTTP_STATS_EVERY == 0) {
+        printf("HttpPool: %i requests, %i reused connections (%i%%), %i connects (%.1f ms avg)\n",
+               stats.requests, stats.reused, stats.reused * 100 / stats.requests, stats.connects,
+               stats.connects ? stats.connectTime * 1000 / stats.connects : 0);
+    }
+    SDL_UnlockMutex(mutex);
+
+    return res;
+}
+
+int HttpPool::preconnectThread(void *data) {
+
+    auto pool = (HttpPool *) data;
+
+    CURL *curl = pool->acquire();
+    if (!curl) {
+        return -1;
+    }
+
+    // same tls options as listings, so the connection (kept by the released handle) can be reused by them
+    curl_easy_setopt(curl, CURLOPT_URL, pool->preconnectUrl.c_str());
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 3L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
+    CURLcode res = pool->perform(curl);
+    printf("HttpPool::preconnect: %s (%s)\n", pool->preconnectUrl.c_str(), curl_easy_strerror(res));
+    pool->release(curl);
+
+    return 0;
+}
+
+void HttpPool::preconnect(const std::string &url) {
+
+    if (!c2d::Utility::startWith(url, "http://") && !c2d::Utility::startWith(url, "https://")) {
+        return;
+    }
+
+    if (thread) {
+        SDL_WaitThread(thread, nullptr);
+        thread = nullptr;
+    }
+
+    // host root only (no escaping needed)
+    size_t slash = url.find('/', url.find("://") + 3);
+    preconnectUrl = slash == std::string::npos ? url + "/" : url.substr(0, slash + 1);
+    thread = SDL_CreateThread(preconnectThread, "preconnect_thread", (void *) this);
+}
+
+HttpPool::Stats HttpPool::getStats() {
+
+    SDL_LockMutex(mutex);
+    Stats s = stats;
+    SDL_UnlockMutex(mutex);
+
+    return s;
+}
+
+HttpPool::~HttpPool() {
+
+    if (thread) {
+        SDL_WaitThread(thread, nullptr);
+    }
+
+    if (stats.requests > 0) {
+        printf("HttpPool: %i requests, %i reused connections (%i%%), %i connects\n",
+               stats.requests, stats.reused, stats.reused * 100 / stats.requests, stats.connects);
+    }
+
+    for (auto &curl : handles) {
+        curl_easy_cleanup(curl);
+    }
+    if (share) {
+        curl_share_cleanup(share);
+    }
+    for (auto &l : locks) {
+        SDL_DestroyMutex(l);
+    }
+    SDL_DestroyMutex(mutex);
+
+    curl_global_cleanup();
+}
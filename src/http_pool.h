@@ -0,0 +1,69 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_HTTP_POOL_H
+#define PPLAY_HTTP_POOL_H
+
+#include <string>
+#include <vector>
+#include <curl/curl.h>
+#include <SDL2/SDL_thread.h>
+
+namespace pplay {
+
+    // pool of curl handles sharing dns and tls session caches. Released handles keep their
+    // connections alive, so listings, probes and scrapping requests to the same host reuse them
+    class HttpPool {
+
+    public:
+
+        class Stats {
+        public:
+            int requests = 0;
+            // requests done on an already opened connection
+            int reused = 0;
+            // new connections, time spent connecting (dns, tcp, tls)
+            int connects = 0;
+            double connectTime = 0;
+        };
+
+        HttpPool();
+
+        ~HttpPool();
+
+        // shared instance
+        static HttpPool *getInstance();
+
+        // last released (or new) easy handle attached to the shared caches, options are reset
+        CURL *acquire();
+
+        void release(CURL *curl);
+
+        // curl_easy_perform, updating reuse stats
+        CURLcode perform(CURL *curl);
+
+        // open a connection to "url" host in background (dns, tcp, tls), kept for next requests
+        void preconnect(const std::string &url);
+
+        Stats getStats();
+
+    private:
+
+        static void lock(CURL *curl, curl_lock_data data, curl_lock_access access, void *userdata);
+
+        static void unlock(CURL *curl, curl_lock_data data, void *userdata);
+
+        static int preconnectThread(void *data);
+
+        CURLSH *share = nullptr;
+        SDL_mutex *locks[CURL_LOCK_DATA_LAST];
+        SDL_mutex *mutex = nullptr;
+        std::vector<CURL *> handles;
+        Stats stats;
+        SDL_Thread *thread = nullptr;
+        std::string preconnectUrl;
+    };
+}
+
+#endif //PPLAY_HTTP_POOL_H
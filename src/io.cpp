@@ -2,10 +2,17 @@
 // Created by cpasjuste on 31/03/19.
 //
 
-#include <regex>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include "io.h"
 #include "media_info.h"
-#include "Browser/Browser.hpp"
+#include "http_index.h"
+#include "http_pool.h"
+#include "ftplib.h"
+
+// idle control connections kept per host
+#define FTP_IDLE_MAX 2
 
 using namespace pplay;
 
@@ -27,14 +34,34 @@ static size_t find_Nth(const std::string &str, unsigned n, const std::string &fi
     return pos;
 }
 
+// percent-encode all but unreserved characters and '/'
+static std::string escape_path(const std::string &path) {
+
+    static const char *hex = "0123456789ABCDEF";
+    std::string escaped;
+
+    escaped.reserve(path.size());
+    for (unsigned char c : path) {
+        if (isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~' || c == '/') {
+            escaped += (char) c;
+        } else {
+            escaped += '%';
+            escaped += hex[c >> 4];
+            escaped += hex[c & 15];
+        }
+    }
+
+    return escaped;
+}
+
 Io::Io() : c2d::C2DIo() {
 
     // http io
-    browser = new Browser();
-    browser->set_handle_gzip(true);
-    browser->set_handle_redirect(true);
-    browser->set_handle_ssl(false);
-    browser->fetch_forms(false);
+    httpMutex = SDL_CreateMutex();
+
+    // ftp io
+    FtpInit();
+    ftpMutex = SDL_CreateMutex();
 }
 
 std::vector<c2d::Io::File> Io::getDirList(const pplay::Io::DeviceType &type, const std::vector<std::string> &extensions,
@@ -47,43 +74,12 @@ std::vector<c2d::Io::File> Io::getDirList(const pplay::Io::DeviceType &type, con
     if (type == DeviceType::Sdmc) {
         files = c2d::C2DIo::getDirList(path, sort, showHidden);
     } else if (type == DeviceType::Http) {
-        std::string http_path = path;
-        if (!c2d::Utility::endsWith(http_path, "/")) {
-            http_path += "/";
-        }
-        // extract home from path
-        size_t pos = find_Nth(http_path, 3, "/");
-        std::string home = http_path.substr(0, pos + 1);
-        std::string dir = browser->escape(http_path.substr(pos + 1, http_path.length() - 1));
-        dir = std::regex_replace(dir, std::regex("%2F"), "/");
-        //printf("home: %s | dir: %s\n", home.c_str(), dir.c_str());
-        browser->open(home + dir, 3);
-        if (browser->error() || browser->links.size() < 1) {
-            return files;
-        }
-        // add up/back ("..")
-        files.emplace_back("..", "..", Io::Type::Directory, 0, c2d::Color::Blue);
-
-        for (int i = 0; i < browser->links.size(); i++) {
-            // skip apache2 stuff
-            if (browser->links[i].name() == ".."
-                || browser->links[i].name() == "../"
-                || browser->links[i].name() == "Name"
-                || browser->links[i].name() == "Last modified"
-                || browser->links[i].name() == "Size"
-                || browser->links[i].name() == "Description"
-                || browser->links[i].name() == "Parent Directory") {
-                continue;
-            }
-
-            Io::Type t = c2d::Utility::endsWith(browser->links[i].name(), "/") ?
-                         Io::Type::Directory : Io::Type::File;
-            std::string name = browser->unescape(browser->links[i].name());
-            if (c2d::Utility::endsWith(name, "/")) {
-                name = c2d::Utility::removeLastSlash(name);
-            }
-            files.emplace_back(name, http_path + name, t);
+        getHttpDirList(path, &files);
+        if (sort) {
+            std::sort(files.begin(), files.end(), compare);
         }
+    } else if (type == DeviceType::Ftp) {
+        getFtpDirList(path, &files);
         if (sort) {
             std::sort(files.begin(), files.end(), compare);
         }
@@ -105,6 +101,219 @@ std::vector<c2d::Io::File> Io::getDirList(const pplay::Io::DeviceType &type, con
     return files;
 }
 
+bool Io::getHttpDirList(const std::string &path, std::vector<Io::File> *files) {
+
+    std::string http_path = path;
+    if (!c2d::Utility::endsWith(http_path, "/")) {
+        http_path += "/";
+    }
+    // extract home from path
+    size_t pos = find_Nth(http_path, 3, "/");
+    std::string home = http_path.substr(0, pos + 1);
+    std::string dir = escape_path(http_path.substr(pos + 1, http_path.length() - 1));
+    std::string url = home + dir;
+    //printf("home: %s | dir: %s\n", home.c_str(), dir.c_str());
+
+    SDL_LockMutex(httpMutex);
+    // try webdav first, once per host
+    bool dav = httpNoDav.count(home) == 0;
+    SDL_UnlockMutex(httpMutex);
+
+    // pooled handle, connection to the host is kept alive between listings
+    CURL *curl = HttpPool::getInstance()->acquire();
+    if (!curl) {
+        return false;
+    }
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    // large listings may take a while, only give up on stalled transfers
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 3L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 3L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, HttpIndex::write);
+
+    // webdav: names, sizes and dates of a directory in one request
+    static const char *propfind =
+            "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+            "<D:propfind xmlns:D=\"DAV:\"><D:prop>"
+            "<D:resourcetype/><D:getcontentlength/><D:getlastmodified/>"
+            "</D:prop></D:propfind>";
+    struct curl_slist *davHeaders = curl_slist_append(nullptr, "Depth: 1");
+    davHeaders = curl_slist_append(davHeaders, "Content-Type: application/xml; charset=utf-8");
+    // caddy answers json when asked, nginx json / xml autoindex are detected, html otherwise
+    struct curl_slist *getHeaders = curl_slist_append(
+            nullptr, "Accept: application/json, text/html;q=0.9, */*;q=0.8");
+
+    HttpIndex index("/" + dir, dav ? HttpIndex::Format::Dav : HttpIndex::Format::Auto);
+    CURLcode res;
+    long code = 0;
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    while (true) {
+        if (dav) {
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, propfind);
+            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PROPFIND");
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, davHeaders);
+        } else {
+            curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, nullptr);
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, getHeaders);
+        }
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &index);
+        res = HttpPool::getInstance()->perform(curl);
+        code = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+        index.finish();
+        if (!dav || res != CURLE_OK || code == 207) {
+            break;
+        }
+        if (code == 400 || code == 405 || code == 501 || code < 300) {
+            // not a webdav server (method refused or ignored), don't ask again
+            printf("Io::getHttpDirList: PROPFIND not supported by %s (http %li), using GET\n", home.c_str(), code);
+            SDL_LockMutex(httpMutex);
+            httpNoDav.insert(home);
+            SDL_UnlockMutex(httpMutex);
+        } else {
+            // this path only (401, 403, 404..), keep webdav for the host
+            printf("Io::getHttpDirList: PROPFIND %s failed (http %li), using GET\n", url.c_str(), code);
+        }
+        index = HttpIndex("/" + dir);
+        dav = false;
+    }
+    HttpPool::getInstance()->release(curl);
+    curl_slist_free_all(davHeaders);
+    curl_slist_free_all(getHeaders);
+
+    if (res != CURLE_OK || code >= 400) {
+        printf("Io::getHttpDirList: %s failed (%s, http %li)\n", url.c_str(), curl_easy_strerror(res), code);
+        return false;
+    }
+
+    // add up/back ("..")
+    files->emplace_back("..", "..", Io::Type::Directory, 0, c2d::Color::Blue);
+    files->reserve(index.entries.size() + 1);
+    for (auto &entry : index.entries) {
+        files->emplace_back(entry.name, http_path + entry.name,
+                            entry.directory ? Io::Type::Directory : Io::Type::File, entry.size);
+    }
+
+    return true;
+}
+
+bool Io::getFtpDirList(const std::string &url, std::vector<Io::File> *files) {
+
+    // ftp://[user[:pass]@]host[:port][/path]
+    size_t start = 6;
+    size_t slash = url.find('/', start);
+    std::string authority = url.substr(start, slash == std::string::npos ? std::string::npos : slash - start);
+    std::string dir = slash == std::string::npos ? "/" : url.substr(slash);
+    std::string user = "anonymous", pass = "pplay@";
+    std::string host = authority;
+    size_t at = authority.rfind('@');
+    if (at != std::string::npos) {
+        std::string userInfo = authority.substr(0, at);
+        size_t colon = userInfo.find(':');
+        user = userInfo.substr(0, colon);
+        pass = colon == std::string::npos ? "" : userInfo.substr(colon + 1);
+        host = authority.substr(at + 1);
+    }
+    std::string key = user + "@" + host;
+    std::string prefix = "ftp://" + authority + dir;
+
+    // an idle connection may have been closed by the server, retry once on a new one
+    for (int retry = 0; retry < 2; retry++) {
+
+        NetBuf *control = ftpAcquire(key, host, user, pass);
+        if (!control) {
+            return false;
+        }
+
+        SDL_LockMutex(ftpMutex);
+        bool mlsd = ftpNoMlsd.count(key) == 0;
+        SDL_UnlockMutex(ftpMutex);
+
+        FtpLastResponse(control)[0] = '\0';
+        files->clear();
+        int res = FtpDirList(dir.c_str(), prefix.c_str(),
+                             mlsd ? FTPLIB_DIR_MACHINE : FTPLIB_DIR_VERBOSE, control, files);
+        if (!res && mlsd && strncmp(FtpLastResponse(control), "50", 2) == 0) {
+            // command not understood / not implemented (500, 502..)
+            printf("Io::getFtpDirList: MLSD not supported by %s, using LIST\n", host.c_str());
+            SDL_LockMutex(ftpMutex);
+            ftpNoMlsd.insert(key);
+            SDL_UnlockMutex(ftpMutex);
+            FtpLastResponse(control)[0] = '\0';
+            files->clear();
+            res = FtpDirList(dir.c_str(), prefix.c_str(), FTPLIB_DIR_VERBOSE, control, files);
+        }
+
+        if (res) {
+            ftpRelease(key, control);
+            return true;
+        }
+
+        printf("Io::getFtpDirList: %s failed: %s\n", url.c_str(), FtpLastResponse(control));
+        if (FtpLastResponse(control)[0] == '5') {
+            // server error (no such directory..), connection is still fine
+            ftpRelease(key, control);
+            return false;
+        }
+        FtpClose(control);
+    }
+
+    return false;
+}
+
+NetBuf *Io::ftpAcquire(const std::string &key, const std::string &host,
+                       const std::string &user, const std::string &pass) {
+
+    NetBuf *control = nullptr;
+
+    SDL_LockMutex(ftpMutex);
+    for (auto it = ftpConnections.begin(); it != ftpConnections.end(); ++it) {
+        if (it->key == key) {
+            control = it->control;
+            ftpConnections.erase(it);
+            break;
+        }
+    }
+    SDL_UnlockMutex(ftpMutex);
+
+    if (control) {
+        return control;
+    }
+
+    if (!FtpConnect(host.c_str(), &control)) {
+        printf("Io::ftpAcquire: could not connect to %s\n", host.c_str());
+        return nullptr;
+    }
+    if (!FtpLogin(user.c_str(), pass.c_str(), control)) {
+        printf("Io::ftpAcquire: login failed on %s: %s\n", host.c_str(), FtpLastResponse(control));
+        FtpQuit(control);
+        return nullptr;
+    }
+
+    return control;
+}
+
+void Io::ftpRelease(const std::string &key, NetBuf *control) {
+
+    SDL_LockMutex(ftpMutex);
+    long count = std::count_if(ftpConnections.begin(), ftpConnections.end(), [&key](const FtpConnection &c) {
+        return c.key == key;
+    });
+    if (count < FTP_IDLE_MAX) {
+        ftpConnections.push_back({key, control});
+        control = nullptr;
+    }
+    SDL_UnlockMutex(ftpMutex);
+
+    if (control) {
+        FtpQuit(control);
+    }
+}
+
 Io::DeviceType Io::getType(const std::string &path) const {
 
     Io::DeviceType type = Io::DeviceType::Sdmc;
@@ -119,5 +328,10 @@ Io::DeviceType Io::getType(const std::string &path) const {
 }
 
 Io::~Io() {
-    delete (browser);
+
+    for (auto &connection : ftpConnections) {
+        FtpQuit(connection.control);
+    }
+    SDL_DestroyMutex(ftpMutex);
+    SDL_DestroyMutex(httpMutex);
 }
@@ -5,9 +5,13 @@
 #ifndef PPLAY_IO_H
 #define PPLAY_IO_H
 
+#include <unordered_set>
+#include <SDL2/SDL_thread.h>
+#include <curl/curl.h>
+
 #include "cross2d/c2d.h"
 
-class Browser;
+struct NetBuf;
 
 namespace pplay {
 
@@ -30,7 +34,32 @@ namespace pplay {
 
     private:
 
-        Browser *browser;
+        // idle ftp control connection, logged in
+        class FtpConnection {
+        public:
+            std::string key;
+            NetBuf *control;
+        };
+
+        // webdav PROPFIND listing, or index page (json, xml or html),
+        // parsed while received (pooled connections, see HttpPool)
+        bool getHttpDirList(const std::string &path, std::vector<Io::File> *files);
+
+        bool getFtpDirList(const std::string &url, std::vector<Io::File> *files);
+
+        // idle connection to "user@host:port", or a new one
+        NetBuf *ftpAcquire(const std::string &key, const std::string &host,
+                           const std::string &user, const std::string &pass);
+
+        void ftpRelease(const std::string &key, NetBuf *control);
+
+        // hosts ("http://host/") not answering PROPFIND
+        std::unordered_set<std::string> httpNoDav;
+        SDL_mutex *httpMutex = nullptr;
+        std::vector<FtpConnection> ftpConnections;
+        // hosts not supporting MLSD
+        std::unordered_set<std::string> ftpNoMlsd;
+        SDL_mutex *ftpMutex = nullptr;
 
     };
 }
@@ -0,0 +1,543 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include <algorithm>
+#include <ctime>
+#include <unordered_set>
+#include <sys/stat.h>
+
+#include "cross2d/c2d.h"
+#include "library.h"
+#include "io.h"
+#include "media_info.h"
+#include "serializer.h"
+#include "utility.h"
+
+// file format: magic, version, varint entries and directories, crc32 of all previous bytes
+#define LIBRARY_MAGIC       0x4C505050  // "PPPL"
+#define LIBRARY_VERSION     1
+#define SCAN_DEPTH_MAX      32
+// directories listed concurrently
+#define SCAN_WORKERS_LOCAL      2
+#define SCAN_WORKERS_NETWORK    4
+// played above this percent of duration
+#define PLAYED_PERCENT      95
+
+using namespace pplay;
+
+static int64_t get_mtime(const std::string &path) {
+
+    struct stat st{};
+    if (stat(path.c_str(), &st) != 0) {
+        return 0;
+    }
+
+    return (int64_t) st.st_mtime;
+}
+
+// path is root or in root (sub) directories
+static bool is_in(const std::string &path, const std::string &root) {
+
+    if (path.compare(0, root.size(), root) != 0) {
+        return false;
+    }
+
+    return path.size() == root.size() || root.back() == '/' || path[root.size()] == '/';
+}
+
+c2d::Io::File Library::Entry::getFile() const {
+    return c2d::Io::File(name, path, c2d::Io::Type::File, size);
+}
+
+Library::Library(const std::string &p) {
+
+    path = p;
+    mutex = SDL_CreateMutex();
+
+    if (!load()) {
+        printf("Library: no (valid) library, starting empty\n");
+    }
+}
+
+Library *Library::getInstance() {
+    static Library library(c2d_renderer->getIo()->getDataPath() + "cache/library.db");
+    return &library;
+}
+
+size_t Library::scan(Io *io, const std::string &root, const std::atomic<bool> *running, const Callback &callback) {
+
+    std::string p = root;
+    if (p.size() > 1 && c2d::Utility::endsWith(p, "/")) {
+        p = c2d::Utility::removeLastSlash(p);
+    }
+
+    Scan scan;
+    scan.library = this;
+    scan.io = io;
+    scan.running = running;
+    scan.callback = callback ? &callback : nullptr;
+    scan.mutex = SDL_CreateMutex();
+    scan.cond = SDL_CreateCond();
+    scan.dirs.emplace_back(p, 0);
+
+    // network listings are mostly waiting on the server, local ones on the device
+    int workers = io->getType(p) == Io::DeviceType::Sdmc ? SCAN_WORKERS_LOCAL : SCAN_WORKERS_NETWORK;
+    std::vector<SDL_Thread *> threads;
+    for (int i = 1; i < workers; i++) {
+        std::string name = "scan_thread" + std::to_string(i);
+        SDL_Thread *thread = SDL_CreateThread(scanThread, name.c_str(), (void *) &scan);
+        if (thread) {
+            threads.push_back(thread);
+        }
+    }
+    // calling thread is a worker too
+    scanThread(&scan);
+    for (auto &thread : threads) {
+        SDL_WaitThread(thread, nullptr);
+    }
+    SDL_DestroyCond(scan.cond);
+    SDL_DestroyMutex(scan.mutex);
+
+    size_t count = 0;
+    SDL_LockMutex(mutex);
+    for (auto &entry : entries) {
+        if (is_in(entry.path, p)) {
+            count++;
+        }
+    }
+    SDL_UnlockMutex(mutex);
+
+    save();
+    printf("Library::scan(%s): %zu entries, %zu directories listed (%i workers)\n",
+           p.c_str(), count, scan.listed, workers);
+
+    return count;
+}
+
+int Library::scanThread(void *data) {
+
+    auto scan = (Scan *) data;
+
+    while (true) {
+
+        SDL_LockMutex(scan->mutex);
+        // wait for directories found by other workers
+        while (scan->dirs.empty() && scan->busy > 0 && (!scan->running || *scan->running)) {
+            SDL_CondWait(scan->cond, scan->mutex);
+        }
+        if (scan->dirs.empty() || (scan->running && !*scan->running)) {
+            // done (or aborted), wake up waiting workers
+            SDL_CondBroadcast(scan->cond);
+            SDL_UnlockMutex(scan->mutex);
+            break;
+        }
+        // depth first, files are found sooner
+        std::pair<std::string, int> dir = std::move(scan->dirs.back());
+        scan->dirs.pop_back();
+        scan->busy++;
+        SDL_UnlockMutex(scan->mutex);
+
+        std::vector<std::string> children;
+        std::vector<Entry> found;
+        scan->library->scanDir(scan->io, dir.first, &children, scan->callback ? &found : nullptr);
+
+        SDL_LockMutex(scan->mutex);
+        if (dir.second < SCAN_DEPTH_MAX) {
+            for (auto &child : children) {
+                scan->dirs.emplace_back(std::move(child), dir.second + 1);
+            }
+        }
+        scan->busy--;
+        scan->listed++;
+        SDL_CondBroadcast(scan->cond);
+        SDL_UnlockMutex(scan->mutex);
+
+        // outside of the lock, the callback may block (consumer queue full)
+        for (auto &entry : found) {
+            (*scan->callback)(entry);
+        }
+    }
+
+    return 0;
+}
+
+void Library::scanDir(Io *io, const std::string &dirPath,
+                      std::vector<std::string> *children, std::vector<Entry> *found) {
+
+    Io::DeviceType type = io->getType(dirPath);
+    int64_t mtime = type == Io::DeviceType::Sdmc ? get_mtime(dirPath) : 0;
+    bool listed = false;
+
+    // local directory not modified since last scan (files added, removed or renamed),
+    // only look for changes in sub directories
+    SDL_LockMutex(mutex);
+    auto it = dirs.find(dirPath);
+    if (it != dirs.end() && mtime != 0 && it->second.mtime == mtime) {
+        *children = it->second.dirs;
+        listed = true;
+        if (found) {
+            getUnscrapped(it->second, found);
+        }
+    }
+    SDL_UnlockMutex(mutex);
+
+    if (!listed) {
+        // list without holding the lock (network)
+        std::vector<c2d::Io::File> files = io->getDirList(type, Utility::getMediaExtensions(), dirPath);
+        if (files.empty() && mtime == 0) {
+            // unreachable, keep what we know
+            return;
+        }
+
+        Dir dir;
+        dir.mtime = mtime;
+        for (auto &file : files) {
+            if (file.name == "." || file.name == "..") {
+                continue;
+            }
+            auto t = (uint8_t) file.type;
+            dir.hash = Utility::crc32(file.path.data(), file.path.size(), dir.hash);
+            dir.hash = Utility::crc32(&file.size, sizeof(file.size), dir.hash);
+            dir.hash = Utility::crc32(&t, 1, dir.hash);
+            if (file.type == c2d::Io::Type::Directory) {
+                dir.dirs.emplace_back(file.path);
+            } else {
+                dir.files.emplace_back(file.path);
+            }
+        }
+
+        SDL_LockMutex(mutex);
+        it = dirs.find(dirPath);
+        if (it == dirs.end() || it->second.hash != dir.hash) {
+            // listing changed: remove deleted files / directories, add new files
+            if (it != dirs.end()) {
+                std::unordered_set<std::string> found(dir.files.begin(), dir.files.end());
+                found.insert(dir.dirs.begin(), dir.dirs.end());
+                for (auto &file : it->second.files) {
+                    if (!found.count(file)) {
+                        removeEntry(file);
+                    }
+                }
+                std::vector<std::string> removed;
+                for (auto &d : it->second.dirs) {
+                    if (!found.count(d)) {
+                        removed.emplace_back(d);
+                    }
+                }
+                for (auto &d : removed) {
+                    removeDir(d);
+                }
+            }
+            for (auto &file : files) {
+                if (file.type == c2d::Io::Type::Directory) {
+                    continue;
+                }
+                auto entry_it = index.find(file.path);
+                if (entry_it == index.end()) {
+                    entry_it = index.emplace(file.path, entries.size()).first;
+                    entries.emplace_back();
+                }
+                Entry &entry = entries[entry_it->second];
+                if (entry.path.empty()) {
+                    entry.path = file.path;
+                    entry.name = file.name;
+                    entry.added = (int64_t) time(nullptr);
+                    // scrapped before the library existed
+                    if (c2d_renderer->getIo()->exist(Utility::getMediaScrapPath(file))) {
+                        entry.status |= Scrapped;
+                    }
+                } else if (entry.size == file.size) {
+                    continue;
+                }
+                // new or modified: probe again
+                entry.size = file.size;
+                entry.status &= ~Probed;
+                if (type == Io::DeviceType::Sdmc) {
+                    entry.mtime = get_mtime(file.path);
+                }
+            }
+            dirty = true;
+        } else if (it->second.mtime != mtime) {
+            dirty = true;
+        }
+        *children = dir.dirs;
+        Dir &d = dirs[dirPath] = std::move(dir);
+        if (found) {
+            getUnscrapped(d, found);
+        }
+        SDL_UnlockMutex(mutex);
+    }
+}
+
+void Library::getUnscrapped(const Dir &dir, std::vector<Entry> *found) {
+
+    for (auto &file : dir.files) {
+        auto it = index.find(file);
+        if (it != index.end() && !(entries[it->second].status & Scrapped)) {
+            found->push_back(entries[it->second]);
+        }
+    }
+}
+
+void Library::removeDir(const std::string &p) {
+
+    auto it = dirs.find(p);
+    if (it == dirs.end()) {
+        return;
+    }
+
+    Dir dir = std::move(it->second);
+    dirs.erase(it);
+    for (auto &file : dir.files) {
+        removeEntry(file);
+    }
+    for (auto &d : dir.dirs) {
+        removeDir(d);
+    }
+}
+
+void Library::removeEntry(const std::string &p) {
+
+    auto it = index.find(p);
+    if (it == index.end()) {
+        return;
+    }
+
+    // move last entry in place
+    size_t i = it->second;
+    index.erase(it);
+    if (i != entries.size() - 1) {
+        entries[i] = std::move(entries.back());
+        index[entries[i].path] = i;
+    }
+    entries.pop_back();
+}
+
+std::vector<Library::Entry> Library::getEntries() {
+
+    SDL_LockMutex(mutex);
+    std::vector<Entry> result = entries;
+    SDL_UnlockMutex(mutex);
+
+    return result;
+}
+
+std::vector<Library::Entry> Library::getRecentlyAdded(size_t max) {
+
+    std::vector<Entry> result;
+
+    SDL_LockMutex(mutex);
+    std::vector<const Entry *> sorted;
+    sorted.reserve(entries.size());
+    for (auto &entry : entries) {
+        sorted.push_back(&entry);
+    }
+    size_t count = std::min(max, sorted.size());
+    std::partial_sort(sorted.begin(), sorted.begin() + count, sorted.end(), [](const Entry *a, const Entry *b) {
+        return a->added != b->added ? a->added > b->added : a->path < b->path;
+    });
+    for (size_t i = 0; i < count; i++) {
+        result.push_back(*sorted[i]);
+    }
+    SDL_UnlockMutex(mutex);
+
+    return result;
+}
+
+std::vector<Library::Entry> Library::getInProgress(size_t max) {
+
+    std::vector<Entry> result;
+
+    SDL_LockMutex(mutex);
+    std::vector<const Entry *> sorted;
+    for (auto &e : entries) {
+        if (e.position > 0 && (e.duration <= 0 || e.position * 100 < e.duration * PLAYED_PERCENT)) {
+            sorted.push_back(&e);
+        }
+    }
+    size_t count = std::min(max, sorted.size());
+    std::partial_sort(sorted.begin(), sorted.begin() + count, sorted.end(), [](const Entry *a, const Entry *b) {
+        return a->last_played != b->last_played ? a->last_played > b->last_played : a->path < b->path;
+    });
+    for (size_t i = 0; i < count; i++) {
+        result.push_back(*sorted[i]);
+    }
+    SDL_UnlockMutex(mutex);
+
+    return result;
+}
+
+std::vector<Library::Entry> Library::getUnscrapped(const std::string &root) {
+
+    std::vector<Entry> result;
+
+    SDL_LockMutex(mutex);
+    for (auto &entry : entries) {
+        if (!(entry.status & Scrapped) && is_in(entry.path, root)) {
+            result.push_back(entry);
+        }
+    }
+    SDL_UnlockMutex(mutex);
+
+    std::sort(result.begin(), result.end(), [](const Entry &a, const Entry &b) {
+        return a.path < b.path;
+    });
+
+    return result;
+}
+
+void Library::setMediaInfo(const std::string &p, const MediaInfo &mediaInfo) {
+
+    SDL_LockMutex(mutex);
+    auto it = index.find(p);
+    if (it != index.end()) {
+        Entry &entry = entries[it->second];
+        if (!mediaInfo.videos.empty() || !mediaInfo.audios.empty()) {
+            entry.status |= Probed;
+        }
+        entry.position = mediaInfo.playbackInfo.position;
+        entry.duration = mediaInfo.duration;
+        entry.last_played = mediaInfo.playbackInfo.last_played;
+        dirty = true;
+    }
+    SDL_UnlockMutex(mutex);
+}
+
+void Library::setScrapped(const std::string &p) {
+
+    SDL_LockMutex(mutex);
+    auto it = index.find(p);
+    if (it != index.end() && !(entries[it->second].status & Scrapped)) {
+        entries[it->second].status |= Scrapped;
+        dirty = true;
+    }
+    SDL_UnlockMutex(mutex);
+}
+
+size_t Library::size() {
+
+    SDL_LockMutex(mutex);
+    size_t count = entries.size();
+    SDL_UnlockMutex(mutex);
+
+    return count;
+}
+
+bool Library::save() {
+
+    std::string data;
+    Writer w(&data);
+
+    SDL_LockMutex(mutex);
+    if (!dirty) {
+        SDL_UnlockMutex(mutex);
+        return true;
+    }
+
+    w.varint(entries.size());
+    for (auto &e : entries) {
+        w.string(e.path);
+        w.string(e.name);
+        w.varint(e.size);
+        w.svarint(e.mtime);
+        w.string(e.etag);
+        w.svarint(e.added);
+        w.varint((uint64_t) e.status);
+        w.svarint(e.position);
+        w.svarint(e.duration);
+        w.svarint(e.last_played);
+    }
+
+    w.varint(dirs.size());
+    for (auto &dir : dirs) {
+        w.string(dir.first);
+        w.svarint(dir.second.mtime);
+        w.varint(dir.second.hash);
+        for (auto list : {&dir.second.files, &dir.second.dirs}) {
+            w.varint(list->size());
+            for (auto &p : *list) {
+                w.string(p);
+            }
+        }
+    }
+    dirty = false;
+    SDL_UnlockMutex(mutex);
+
+    if (!DataFile::write(path, LIBRARY_MAGIC, LIBRARY_VERSION, data)) {
+        // try again on next save
+        SDL_LockMutex(mutex);
+        dirty = true;
+        SDL_UnlockMutex(mutex);
+        return false;
+    }
+
+    return true;
+}
+
+bool Library::load() {
+
+    std::string data;
+    if (!DataFile::read(path, LIBRARY_MAGIC, LIBRARY_VERSION, &data)) {
+        return false;
+    }
+
+    Reader r((const uint8_t *) data.data(), data.size());
+    std::vector<Entry> e;
+    std::unordered_map<std::string, size_t> i;
+    std::unordered_map<std::string, Dir> d;
+
+    uint64_t count = r.varint();
+    for (uint64_t n = 0; n < count && r.ok; n++) {
+        Entry entry;
+        r.string(&entry.path);
+        r.string(&entry.name);
+        entry.size = (size_t) r.varint();
+        entry.mtime = r.svarint();
+        r.string(&entry.etag);
+        entry.added = r.svarint();
+        entry.status = (int) r.varint();
+        entry.position = r.svarint();
+        entry.duration = r.svarint();
+        entry.last_played = r.svarint();
+        if (i.emplace(entry.path, e.size()).second) {
+            e.emplace_back(std::move(entry));
+        }
+    }
+
+    count = r.varint();
+    for (uint64_t n = 0; n < count && r.ok; n++) {
+        std::string p;
+        Dir dir;
+        r.string(&p);
+        dir.mtime = r.svarint();
+        dir.hash = (uint32_t) r.varint();
+        for (auto list : {&dir.files, &dir.dirs}) {
+            uint64_t size = r.varint();
+            for (uint64_t j = 0; j < size && r.ok; j++) {
+                std::string s;
+                r.string(&s);
+                list->emplace_back(std::move(s));
+            }
+        }
+        d[p] = std::move(dir);
+    }
+
+    if (!r.ok) {
+        return false;
+    }
+
+    SDL_LockMutex(mutex);
+    entries = std::move(e);
+    index = std::move(i);
+    dirs = std::move(d);
+    SDL_UnlockMutex(mutex);
+
+    return true;
+}
+
+Library::~Library() {
+
+    save();
+    SDL_DestroyMutex(mutex);
+}
@@ -0,0 +1,143 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_LIBRARY_H
+#define PPLAY_LIBRARY_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <SDL2/SDL_thread.h>
+
+#include "cross2d/skeleton/io.h"
+
+class MediaInfo;
+
+namespace pplay {
+
+    class Io;
+
+    // persistent index of all media files found under scanned roots (local, http..),
+    // saved to "cache/library.db". Rescans only list directories whose mtime (local)
+    // changed, and only update entries of directories whose listing changed.
+    class Library {
+
+    public:
+
+        // entry status flags
+        enum Status {
+            Probed = 1,
+            Scrapped = 2
+        };
+
+        class Entry {
+        public:
+            std::string path;
+            std::string name;
+            size_t size = 0;
+            // local files modification time, remote files etag (if reported)
+            int64_t mtime = 0;
+            std::string etag;
+            // first seen time
+            int64_t added = 0;
+            int status = 0;
+            // playback (from media info)
+            int64_t position = 0;
+            int64_t duration = 0;
+            int64_t last_played = 0;
+
+            c2d::Io::File getFile() const;
+        };
+
+        typedef std::function<void(const Entry &entry)> Callback;
+
+        explicit Library(const std::string &path);
+
+        ~Library();
+
+        // shared instance, in data path cache directory
+        static Library *getInstance();
+
+        // (re)scan root recursively, directories being listed by a few workers, returns entries count under root.
+        // "running" is checked between directories (abort). "callback" is called from workers with
+        // not scrapped entries as soon as their directory is listed, it may block to slow down the scan
+        size_t scan(Io *io, const std::string &root, const std::atomic<bool> *running = nullptr,
+                    const Callback &callback = nullptr);
+
+        // copy of all entries (search index)
+        std::vector<Entry> getEntries();
+
+        // most recently found first
+        std::vector<Entry> getRecentlyAdded(size_t max = 50);
+
+        // started but not finished, most recently played first
+        std::vector<Entry> getInProgress(size_t max = 50);
+
+        // entries under root never scrapped, by path
+        std::vector<Entry> getUnscrapped(const std::string &root);
+
+        // update probe / playback status from (saved) media info
+        void setMediaInfo(const std::string &path, const MediaInfo &mediaInfo);
+
+        void setScrapped(const std::string &path);
+
+        size_t size();
+
+        bool save();
+
+    private:
+
+        class Dir {
+        public:
+            int64_t mtime = 0;
+            // names, sizes and types of listed files
+            uint32_t hash = 0;
+            std::vector<std::string> files;
+            std::vector<std::string> dirs;
+        };
+
+        // directories to list (path, depth) shared by scan workers
+        class Scan {
+        public:
+            Library *library = nullptr;
+            Io *io = nullptr;
+            const std::atomic<bool> *running = nullptr;
+            const Callback *callback = nullptr;
+            SDL_mutex *mutex = nullptr;
+            SDL_cond *cond = nullptr;
+            std::vector<std::pair<std::string, int>> dirs;
+            // directories being listed
+            int busy = 0;
+            size_t listed = 0;
+        };
+
+        static int scanThread(void *data);
+
+        // list (if changed) a directory, returns its sub directories and, if "found" is set, its not scrapped entries
+        void scanDir(Io *io, const std::string &path, std::vector<std::string> *children, std::vector<Entry> *found);
+
+        // not scrapped entries of a directory (locked)
+        void getUnscrapped(const Dir &dir, std::vector<Entry> *found);
+
+        // remove directory, sub directories and their entries
+        void removeDir(const std::string &path);
+
+        void removeEntry(const std::string &path);
+
+        bool load();
+
+        std::string path;
+        SDL_mutex *mutex = nullptr;
+        // entries are contiguous (queries scan them all), path to entry index
+        std::vector<Entry> entries;
+        std::unordered_map<std::string, size_t> index;
+        std::unordered_map<std::string, Dir> dirs;
+        bool dirty = false;
+    };
+}
+
+#endif //PPLAY_LIBRARY_H
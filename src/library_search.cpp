@@ -0,0 +1,545 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "cross2d/c2d.h"
+#include "library_search.h"
+#include "library.h"
+#include "media_info.h"
+#include "serializer.h"
+#include "utility.h"
+#include "p_search.h"
+
+// file format: magic, version, varint terms and documents, crc32 of all previous bytes
+#define SEARCH_MAGIC        0x53505050  // "PPPS"
+#define SEARCH_VERSION      1
+// media info loaded per batch (one store lock)
+#define UPDATE_BATCH        256
+#define QUERY_TOKENS_MAX    8
+// match quality
+#define MATCH_EXACT         3
+#define MATCH_PREFIX        2
+#define MATCH_FUZZY         1
+
+using namespace pplay;
+
+static std::string fold(const std::string &str) {
+
+    std::string folded(str);
+    for (auto &c : folded) {
+        if (c >= 'A' && c <= 'Z') {
+            c = (char) (c - 'A' + 'a');
+        }
+    }
+
+    return folded;
+}
+
+// lower case words (utf-8 bytes are kept in words)
+static std::vector<std::string> split(const std::string &text) {
+
+    std::vector<std::string> words;
+    std::string word;
+
+    for (char c : fold(text)) {
+        auto u = (unsigned char) c;
+        if ((u >= 'a' && u <= 'z') || (u >= '0' && u <= '9') || u >= 0x80) {
+            word.push_back(c);
+        } else if (!word.empty()) {
+            words.emplace_back(std::move(word));
+            word.clear();
+        }
+    }
+    if (!word.empty()) {
+        words.emplace_back(std::move(word));
+    }
+
+    return words;
+}
+
+// edit distance (transposition of adjacent characters is one edit), or max + 1 if above max
+static int distance(const std::string &a, const std::string &b, int max) {
+
+    std::vector<int> prev2(b.size() + 1), prev(b.size() + 1), cur(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); j++) {
+        prev[j] = (int) j;
+    }
+
+    for (size_t i = 1; i <= a.size(); i++) {
+        cur[0] = (int) i;
+        int best = cur[0];
+        for (size_t j = 1; j <= b.size(); j++) {
+            int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+            cur[j] = std::min(std::min(prev[j] + 1, cur[j - 1] + 1), prev[j - 1] + cost);
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1]) {
+                cur[j] = std::min(cur[j], prev2[j - 2] + 1);
+            }
+            best = std::min(best, cur[j]);
+        }
+        if (best > max) {
+            return max + 1;
+        }
+        std::swap(prev2, prev);
+        std::swap(prev, cur);
+    }
+
+    return std::min(prev[b.size()], max + 1);
+}
+
+// entry content changed (new file, probed, scrapped)
+static uint32_t fingerprint(const Library::Entry &entry) {
+
+    int status = entry.status & (Library::Probed | Library::Scrapped);
+    uint32_t crc = Utility::crc32(&entry.size, sizeof(entry.size));
+    crc = Utility::crc32(&entry.mtime, sizeof(entry.mtime), crc);
+    crc = Utility::crc32(entry.etag.data(), entry.etag.size(), crc);
+
+    return Utility::crc32(&status, sizeof(status), crc);
+}
+
+LibrarySearch::LibrarySearch(const std::string &p) {
+
+    path = p;
+    mutex = SDL_CreateMutex();
+
+    std::string data;
+    if (!DataFile::read(path, SEARCH_MAGIC, SEARCH_VERSION, &data)) {
+        return;
+    }
+
+    Reader r((const uint8_t *) data.data(), data.size());
+    uint64_t count = r.varint();
+    for (uint64_t i = 0; i < count && r.ok; i++) {
+        std::string term;
+        r.string(&term);
+        getTerm(term);
+    }
+    count = r.varint();
+    for (uint64_t i = 0; i < count && r.ok; i++) {
+        Doc doc;
+        r.string(&doc.path);
+        r.string(&doc.title);
+        doc.fingerprint = (uint32_t) r.varint();
+        r.string(&doc.terms);
+        doc_index[doc.path] = (uint32_t) docs.size();
+        docs.emplace_back(std::move(doc));
+    }
+
+    // term ids are checked, postings are rebuilt from documents
+    for (auto &doc : docs) {
+        Reader t((const uint8_t *) doc.terms.data(), doc.terms.size());
+        while (t.ok && t.p < t.end) {
+            if ((t.varint() >> 2) >= terms.size()) {
+                r.ok = false;
+            }
+        }
+    }
+    if (!r.ok) {
+        printf("LibrarySearch: invalid index, starting empty\n");
+        docs.clear();
+        doc_index.clear();
+        terms.clear();
+        term_index.clear();
+        postings.clear();
+        return;
+    }
+
+    for (uint32_t id = 0; id < docs.size(); id++) {
+        addPostings(id);
+    }
+}
+
+LibrarySearch *LibrarySearch::getInstance() {
+    static LibrarySearch search(c2d_renderer->getIo()->getDataPath() + "cache/search.db");
+    return &search;
+}
+
+void LibrarySearch::tokenize(const std::string &text, int field, Terms *t) {
+
+    for (auto &word : split(text)) {
+        // skip short overview words ("a", "of"..)
+        if (word.size() < 2 || (field == Overview && word.size() < 3)) {
+            continue;
+        }
+        auto it = t->find(word);
+        if (it == t->end()) {
+            t->emplace(word, field);
+        } else if (it->second < field) {
+            it->second = field;
+        }
+    }
+}
+
+uint32_t LibrarySearch::getTerm(const std::string &term) {
+
+    auto it = term_index.find(term);
+    if (it != term_index.end()) {
+        return it->second;
+    }
+
+    auto id = (uint32_t) terms.size();
+    terms.emplace_back(term);
+    term_index.emplace(term, id);
+    postings.emplace_back();
+    sorted_dirty = true;
+
+    return id;
+}
+
+void LibrarySearch::add(Doc doc, const Terms &t) {
+
+    Writer w(&doc.terms);
+    doc.terms.clear();
+    for (auto &term : t) {
+        w.varint((uint64_t) getTerm(term.first) << 2 | (uint64_t) term.second);
+    }
+
+    auto id = (uint32_t) docs.size();
+    doc_index[doc.path] = id;
+    docs.emplace_back(std::move(doc));
+    addPostings(id);
+    dirty = true;
+}
+
+void LibrarySearch::addPostings(uint32_t id) {
+
+    const std::string &t = docs[id].terms;
+    Reader r((const uint8_t *) t.data(), t.size());
+    while (r.ok && r.p < r.end) {
+        uint64_t v = r.varint();
+        postings[v >> 2].push_back(id << 2 | (uint32_t) (v & 3));
+    }
+}
+
+void LibrarySearch::remove(const std::string &p) {
+
+    auto it = doc_index.find(p);
+    if (it == doc_index.end()) {
+        return;
+    }
+
+    // postings are cleaned on compaction
+    docs[it->second].alive = false;
+    docs[it->second].terms.clear();
+    doc_index.erase(it);
+    dead++;
+    dirty = true;
+}
+
+void LibrarySearch::compact() {
+
+    std::vector<Doc> alive;
+    std::vector<std::string> used;
+    std::vector<uint32_t> remap(terms.size(), UINT32_MAX);
+
+    alive.reserve(docs.size() - dead);
+    for (auto &doc : docs) {
+        if (!doc.alive) {
+            continue;
+        }
+        // renumber terms, unused ones are dropped
+        std::string t;
+        Writer w(&t);
+        Reader r((const uint8_t *) doc.terms.data(), doc.terms.size());
+        while (r.ok && r.p < r.end) {
+            uint64_t v = r.varint();
+            auto term = (uint32_t) (v >> 2);
+            if (remap[term] == UINT32_MAX) {
+                remap[term] = (uint32_t) used.size();
+                used.emplace_back(std::move(terms[term]));
+            }
+            w.varint((uint64_t) remap[term] << 2 | (v & 3));
+        }
+        doc.terms = std::move(t);
+        alive.emplace_back(std::move(doc));
+    }
+
+    docs = std::move(alive);
+    terms = std::move(used);
+    dead = 0;
+    doc_index.clear();
+    term_index.clear();
+    postings.assign(terms.size(), std::vector<uint32_t>());
+    for (uint32_t id = 0; id < terms.size(); id++) {
+        term_index.emplace(terms[id], id);
+    }
+    for (uint32_t id = 0; id < docs.size(); id++) {
+        doc_index[docs[id].path] = id;
+        addPostings(id);
+    }
+    sorted_dirty = true;
+}
+
+void LibrarySearch::update(Library *library, const std::atomic<bool> *running) {
+
+    std::vector<Library::Entry> entries = library->getEntries();
+    std::vector<const Library::Entry *> changed;
+    std::vector<std::string> removed;
+
+    SDL_LockMutex(mutex);
+    std::unordered_set<std::string> found;
+    found.reserve(entries.size());
+    for (auto &entry : entries) {
+        found.insert(entry.path);
+        auto it = doc_index.find(entry.path);
+        if (it == doc_index.end() || docs[it->second].fingerprint != fingerprint(entry)) {
+            changed.push_back(&entry);
+        }
+    }
+    for (auto &doc : doc_index) {
+        if (!found.count(doc.first)) {
+            removed.emplace_back(doc.first);
+        }
+    }
+    for (auto &p : removed) {
+        remove(p);
+    }
+    SDL_UnlockMutex(mutex);
+
+    // load media info and scrap data without holding the lock
+    for (size_t i = 0; i < changed.size(); i += UPDATE_BATCH) {
+        if (running && !*running) {
+            break;
+        }
+
+        std::vector<c2d::Io::File> files;
+        for (size_t j = i; j < changed.size() && j < i + UPDATE_BATCH; j++) {
+            files.emplace_back(changed[j]->getFile());
+        }
+        std::vector<MediaInfo> mediaInfos = MediaInfo::load(files);
+
+        std::vector<std::pair<Doc, Terms>> batch(files.size());
+        for (size_t j = 0; j < files.size(); j++) {
+            const Library::Entry &entry = *changed[i + j];
+            Doc &doc = batch[j].first;
+            Terms &t = batch[j].second;
+            doc.path = entry.path;
+            doc.title = c2d::Utility::removeExt(entry.name);
+            doc.fingerprint = fingerprint(entry);
+            tokenize(doc.title, Name, &t);
+
+            if (entry.status & Library::Scrapped) {
+                pscrap::Search search;
+                search.load(Utility::getMediaScrapPath(files[j]));
+                if (search.total_results > 0 && !search.movies.empty()) {
+                    const pscrap::Movie &movie = search.movies[0];
+                    doc.title = movie.title;
+                    tokenize(movie.title, Title, &t);
+                    tokenize(movie.original_title, Title, &t);
+                    tokenize(movie.overview, Overview, &t);
+                    tokenize(movie.release_date.substr(0, 4), Tag, &t);
+                }
+            }
+
+            // "1080p hevc eng" like filters
+            for (auto &track : mediaInfos[j].videos) {
+                int size = std::max(track.width * 9 / 16, track.height);
+                const char *resolution = size >= 2000 ? "2160p 4k uhd" : size >= 1000 ? "1080p hd"
+                                                                          : size >= 700 ? "720p hd" : "sd";
+                tokenize(resolution, Tag, &t);
+                tokenize(track.codec, Tag, &t);
+                if (track.codec == "hevc") {
+                    tokenize("h265 x265", Tag, &t);
+                } else if (track.codec == "h264") {
+                    tokenize("avc x264", Tag, &t);
+                }
+            }
+            for (auto &track : mediaInfos[j].audios) {
+                tokenize(track.codec + " " + track.language, Tag, &t);
+            }
+            for (auto &track : mediaInfos[j].subtitles) {
+                tokenize(track.language, Tag, &t);
+            }
+        }
+
+        SDL_LockMutex(mutex);
+        for (auto &item : batch) {
+            remove(item.first.path);
+            add(std::move(item.first), item.second);
+        }
+        SDL_UnlockMutex(mutex);
+    }
+
+    SDL_LockMutex(mutex);
+    if (dead > docs.size() / 2) {
+        compact();
+    }
+    SDL_UnlockMutex(mutex);
+
+    printf("LibrarySearch::update: %zu indexed, %zu removed\n", changed.size(), removed.size());
+    save();
+}
+
+void LibrarySearch::match(const std::string &token, std::vector<std::pair<uint32_t, int>> *matches) {
+
+    auto less = [this](uint32_t id, const std::string &str) {
+        return terms[id] < str;
+    };
+
+    // exact, then prefix (two characters or more)
+    auto it = std::lower_bound(sorted.begin(), sorted.end(), token, less);
+    for (; it != sorted.end(); ++it) {
+        const std::string &term = terms[*it];
+        if (term.compare(0, token.size(), token) != 0) {
+            break;
+        }
+        if (term.size() == token.size()) {
+            matches->emplace_back(*it, MATCH_EXACT);
+        } else if (token.size() >= 2) {
+            matches->emplace_back(*it, MATCH_PREFIX);
+        } else {
+            break;
+        }
+    }
+
+    if (!matches->empty() || token.size() < 4) {
+        return;
+    }
+
+    // typo: terms starting with the same character, close enough
+    int max = token.size() >= 8 ? 2 : 1;
+    auto end = std::lower_bound(sorted.begin(), sorted.end(), std::string(1, (char) (token[0] + 1)), less);
+    for (it = std::lower_bound(sorted.begin(), sorted.end(), std::string(1, token[0]), less); it != end; ++it) {
+        const std::string &term = terms[*it];
+        if (std::abs((int) term.size() - (int) token.size()) <= max && distance(term, token, max) <= max) {
+            matches->emplace_back(*it, MATCH_FUZZY);
+        }
+    }
+}
+
+std::vector<LibrarySearch::Result> LibrarySearch::find(const std::string &query, size_t max) {
+
+    std::vector<Result> results;
+    std::vector<std::string> tokens = split(query);
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+    if (tokens.empty()) {
+        return results;
+    }
+    if (tokens.size() > QUERY_TOKENS_MAX) {
+        tokens.resize(QUERY_TOKENS_MAX);
+    }
+
+    SDL_LockMutex(mutex);
+
+    if (sorted_dirty) {
+        sorted.resize(terms.size());
+        for (uint32_t id = 0; id < terms.size(); id++) {
+            sorted[id] = id;
+        }
+        std::sort(sorted.begin(), sorted.end(), [this](uint32_t a, uint32_t b) {
+            return terms[a] < terms[b];
+        });
+        sorted_dirty = false;
+    }
+
+    // documents must match every token, score is the sum of
+    // best (match quality * field weight) per token
+    std::vector<uint16_t> scores(docs.size(), 0);
+    std::vector<uint8_t> counts(docs.size(), 0);
+    std::vector<uint8_t> best(docs.size(), 0);
+    std::vector<uint32_t> touched;
+    std::vector<std::pair<uint32_t, int>> matches;
+
+    for (size_t i = 0; i < tokens.size(); i++) {
+        matches.clear();
+        touched.clear();
+        match(tokens[i], &matches);
+        for (auto &m : matches) {
+            for (uint32_t posting : postings[m.first]) {
+                uint32_t doc = posting >> 2;
+                if (counts[doc] != i || !docs[doc].alive) {
+                    continue;
+                }
+                auto score = (uint8_t) (m.second * ((posting & 3) + 1));
+                if (best[doc] == 0) {
+                    touched.push_back(doc);
+                }
+                best[doc] = std::max(best[doc], score);
+            }
+        }
+        for (uint32_t doc : touched) {
+            scores[doc] += best[doc];
+            counts[doc]++;
+            best[doc] = 0;
+        }
+        if (touched.empty()) {
+            break;
+        }
+    }
+
+    // last token matches are the documents matching all tokens
+    size_t count = std::min(max, touched.size());
+    std::partial_sort(touched.begin(), touched.begin() + count, touched.end(), [&](uint32_t a, uint32_t b) {
+        if (scores[a] != scores[b]) {
+            return scores[a] > scores[b];
+        }
+        return docs[a].title < docs[b].title;
+    });
+    for (size_t i = 0; i < count; i++) {
+        const Doc &doc = docs[touched[i]];
+        results.push_back({doc.path, doc.title, scores[touched[i]]});
+    }
+
+    SDL_UnlockMutex(mutex);
+
+    return results;
+}
+
+size_t LibrarySearch::size() {
+
+    SDL_LockMutex(mutex);
+    size_t count = docs.size() - dead;
+    SDL_UnlockMutex(mutex);
+
+    return count;
+}
+
+bool LibrarySearch::save() {
+
+    std::string data;
+    Writer w(&data);
+
+    SDL_LockMutex(mutex);
+    if (!dirty) {
+        SDL_UnlockMutex(mutex);
+        return true;
+    }
+
+    if (dead > 0) {
+        compact();
+    }
+
+    w.varint(terms.size());
+    for (auto &term : terms) {
+        w.string(term);
+    }
+    w.varint(docs.size());
+    for (auto &doc : docs) {
+        w.string(doc.path);
+        w.string(doc.title);
+        w.varint(doc.fingerprint);
+        w.string(doc.terms);
+    }
+    dirty = false;
+    SDL_UnlockMutex(mutex);
+
+    if (!DataFile::write(path, SEARCH_MAGIC, SEARCH_VERSION, data)) {
+        // try again on next save
+        SDL_LockMutex(mutex);
+        dirty = true;
+        SDL_UnlockMutex(mutex);
+        return false;
+    }
+
+    return true;
+}
+
+LibrarySearch::~LibrarySearch() {
+
+    save();
+    SDL_DestroyMutex(mutex);
+}
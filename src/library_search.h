@@ -0,0 +1,107 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_LIBRARY_SEARCH_H
+#define PPLAY_LIBRARY_SEARCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <SDL2/SDL_thread.h>
+
+namespace pplay {
+
+    class Library;
+
+    // inverted index over library entries: file names, scrapped titles, original titles,
+    // years and overviews, tracks codecs / languages and resolution tags ("1080p hevc").
+    // Indexed terms are saved to "cache/search.db", only new or changed entries
+    // are indexed again on update.
+    class LibrarySearch {
+
+    public:
+
+        class Result {
+        public:
+            std::string path;
+            std::string title;
+            int score;
+        };
+
+        explicit LibrarySearch(const std::string &path);
+
+        ~LibrarySearch();
+
+        // shared instance, in data path cache directory
+        static LibrarySearch *getInstance();
+
+        // index new / changed library entries, remove deleted ones.
+        // "running" is checked between entries (abort)
+        void update(Library *library, const std::atomic<bool> *running = nullptr);
+
+        // entries matching all query words (exact, prefix or close spelling), best first
+        std::vector<Result> find(const std::string &query, size_t max = 100);
+
+        size_t size();
+
+        bool save();
+
+    private:
+
+        // term weight, by field
+        enum Field {
+            Overview = 0,
+            // codecs, languages, resolution, year
+            Tag = 1,
+            Name = 2,
+            Title = 3
+        };
+
+        class Doc {
+        public:
+            std::string path;
+            std::string title;
+            uint32_t fingerprint = 0;
+            // varint list of (term id << 2 | field), one per term
+            std::string terms;
+            bool alive = true;
+        };
+
+        typedef std::unordered_map<std::string, int> Terms;
+
+        static void tokenize(const std::string &text, int field, Terms *terms);
+
+        uint32_t getTerm(const std::string &term);
+
+        void add(Doc doc, const Terms &terms);
+
+        void addPostings(uint32_t id);
+
+        void remove(const std::string &path);
+
+        // drop removed documents from postings
+        void compact();
+
+        // matching terms ids, with match quality
+        void match(const std::string &token, std::vector<std::pair<uint32_t, int>> *matches);
+
+        std::string path;
+        SDL_mutex *mutex = nullptr;
+        std::vector<Doc> docs;
+        std::unordered_map<std::string, uint32_t> doc_index;
+        size_t dead = 0;
+        // dictionary, term ids sorted by term (prefix search)
+        std::vector<std::string> terms;
+        std::unordered_map<std::string, uint32_t> term_index;
+        std::vector<uint32_t> sorted;
+        bool sorted_dirty = false;
+        // per term: (doc id << 2 | field), doc ids ascending
+        std::vector<std::vector<uint32_t>> postings;
+        bool dirty = false;
+    };
+}
+
+#endif //PPLAY_LIBRARY_SEARCH_H
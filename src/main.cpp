@@ -3,6 +3,7 @@
 //
 #include "main.h"
 #include "io.h"
+#include "http_pool.h"
 #include "filer.h"
 #include "menu_main.h"
 #include "menu_video.h"
@@ -59,6 +60,9 @@ Main::Main(const c2d::Vector2f &size) : C2DRenderer(size) {
     // init/load config file
     config = new PPLAYConfig(this);
 
+    // open network connection early, kept alive for first listing
+    HttpPool::getInstance()->preconnect(config->getOption(OPT_NETWORK)->getString());
+
     // scaling
     scaling = size.x / 1280.0f;
 
@@ -75,6 +79,10 @@ Main::Main(const c2d::Vector2f &size) : C2DRenderer(size) {
 
     // media information cache
     getIo()->create(getIo()->getDataPath() + "cache");
+    // background media information probing, used by filer
+    prober = new Prober(this);
+    // background media information / scrap data loading, used by filer
+    mediaLoader = new MediaLoader(this);
 
     // create filer
     FloatRect filerRect = {0, 0, getSize().x, getSize().y};
@@ -100,6 +108,7 @@ Main::Main(const c2d::Vector2f &size) : C2DRenderer(size) {
     items.emplace_back("Usb", "usb.png", MenuItem::Position::Top);
 #endif
     items.emplace_back("Network", "network.png", MenuItem::Position::Top);
+    items.emplace_back("Search", "video.png", MenuItem::Position::Top);
     items.emplace_back("Options", "options.png", MenuItem::Position::Top);
     items.emplace_back("Exit", "exit.png", MenuItem::Position::Bottom);
     menu_main = new MenuMain(this, {-250 * scaling, 0, 250 * scaling, getSize().y}, items);
@@ -140,6 +149,8 @@ Main::Main(const c2d::Vector2f &size) : C2DRenderer(size) {
 }
 
 Main::~Main() {
+    delete (mediaLoader);
+    delete (prober);
     delete (scrapper);
     delete (config);
     delete (timer);
@@ -188,6 +199,11 @@ void Main::onUpdate() {
         }
     }
 
+    // previous frame was flipped, used for frame pacing
+    if (player != nullptr) {
+        player->onSwap();
+    }
+
     C2DRenderer::onUpdate();
 }
 
@@ -301,6 +317,14 @@ pplay::Scrapper *Main::getScrapper() {
     return scrapper;
 }
 
+pplay::Prober *Main::getProber() {
+    return prober;
+}
+
+pplay::MediaLoader *Main::getMediaLoader() {
+    return mediaLoader;
+}
+
 c2d::Io *Main::getIo() {
     return (c2d::Io *) pplayIo;
 }
@@ -15,6 +15,8 @@
 #include "status_box.h"
 #include "status_bar.h"
 #include "scrapper.h"
+#include "prober.h"
+#include "media_loader.h"
 #include "io.h"
 #include "usbfs.h"
 
@@ -91,6 +93,10 @@ public:
 
     pplay::Scrapper *getScrapper();
 
+    pplay::Prober *getProber();
+
+    pplay::MediaLoader *getMediaLoader();
+
     c2d::Io *getIo() override;
 
     float getScaling();
@@ -117,6 +123,8 @@ private:
     MenuMain *menu_main = nullptr;
     MenuVideo *menu_video = nullptr;
     pplay::Scrapper *scrapper = nullptr;
+    pplay::Prober *prober = nullptr;
+    pplay::MediaLoader *mediaLoader = nullptr;
     unsigned int oldKeys = 0;
     float scaling = 1;
 
@@ -2,321 +2,210 @@
 // Created by cpasjuste on 13/11/18.
 //
 
-#include <fstream>
-#include <iostream>
-
 #include "cross2d/c2d.h"
 #include "media_info.h"
+#include "library.h"
+#include "media_store.h"
+#include "serializer.h"
 #include "utility.h"
 
+// record format (v2): magic, version, varint fields, crc32 of all previous bytes (little endian)
+// v3: last played time
+#define MEDIA_INFO_MAGIC    0xB7
+#define MEDIA_INFO_VERSION  3
+#define MEDIA_INFO_TRACKS   256
+
 MediaInfo::MediaInfo(const c2d::Io::File &file) {
 
-    serialize_path = pplay::Utility::getMediaInfoPath(file);
     if (!pplay::Utility::isMedia(file)) {
         return;
     }
-    deserialize();
+
+    pplay::MediaStore::getInstance()->get(
+            pplay::Utility::getMediaInfoKey(file), [this](const uint8_t *data, size_t size) {
+                deserialize(data, size);
+            });
 }
 
 void MediaInfo::save(const c2d::Io::File &file) {
 
-    serialize_path = pplay::Utility::getMediaInfoPath(file);
-    serialize();
+    std::string data;
+    if (serialize(&data)) {
+        pplay::MediaStore::getInstance()->put(pplay::Utility::getMediaInfoKey(file), data);
+        pplay::Library::getInstance()->setMediaInfo(file.path, *this);
+    }
 }
 
-bool MediaInfo::serialize() {
+std::vector<MediaInfo> MediaInfo::load(const std::vector<c2d::Io::File> &files) {
 
-    int count;
-    size_t size;
-    std::fstream fs;
+    std::vector<uint64_t> keys;
+    std::vector<MediaInfo> mediaInfos(files.size());
 
-    fs.open(serialize_path.c_str(), std::ios::binary | std::ios::out);
-    if (!fs.is_open()) {
-        return false;
+    keys.reserve(files.size());
+    for (auto &file : files) {
+        keys.push_back(pplay::Utility::getMediaInfoKey(file));
     }
 
-    // title
-    size = title.size();
-    fs.write((char *) &size, sizeof(size_t));
-    fs.write((char *) title.c_str(), size);
-    //printf("Media::serialize: title = %s\n", title.c_str());
-
-    // path
-    size = path.size();
-    fs.write((char *) &size, sizeof(size_t));
-    fs.write((char *) path.c_str(), size);
-    //printf("Media::serialize: path = %s\n", path.c_str());
-
-    // duration
-    fs.write((char *) &duration, sizeof(duration));
-    //printf("Media::serialize: duration = %li\n", duration);
-
-    // bit rate
-    fs.write((char *) &bit_rate, sizeof(bit_rate));
-
-    // media playback status
-    fs.write((char *) &playbackInfo.vid_id, sizeof(playbackInfo.vid_id));
-    fs.write((char *) &playbackInfo.aud_id, sizeof(playbackInfo.aud_id));
-    fs.write((char *) &playbackInfo.sub_id, sizeof(playbackInfo.sub_id));
-    fs.write((char *) &playbackInfo.position, sizeof(playbackInfo.position));
-
-    // video streams
-    count = (int) videos.size();
-    fs.write((char *) &count, sizeof(count));
-    //printf("Media::serialize: video streams = %i\n", count);
-    for (auto &stream : videos) {
-        // id
-        fs.write((char *) &stream.id, sizeof(stream.id));
-        // type
-        size = stream.type.size();
-        fs.write((char *) &size, sizeof(size_t));
-        fs.write((char *) stream.type.c_str(), size);
-        // title
-        size = stream.title.size();
-        fs.write((char *) &size, sizeof(size_t));
-        fs.write((char *) stream.title.c_str(), size);
-        // language
-        size = stream.language.size();
-        fs.write((char *) &size, sizeof(size_t));
-        fs.write((char *) stream.language.c_str(), size);
-        // codec
-        size = stream.codec.size();
-        fs.write((char *) &size, sizeof(size_t));
-        fs.write((char *) stream.codec.c_str(), size);
-        // rate
-        fs.write((char *) &stream.bit_rate, sizeof(stream.bit_rate));
-        // width / height
-        fs.write((char *) &stream.width, sizeof(stream.width));
-        fs.write((char *) &stream.height, sizeof(stream.height));
-    }
+    pplay::MediaStore::getInstance()->get(keys, [&files, &mediaInfos](size_t i, const uint8_t *data, size_t size) {
+        if (pplay::Utility::isMedia(files[i])) {
+            mediaInfos[i].deserialize(data, size);
+        }
+    });
 
-    // audio streams
-    count = (int) audios.size();
-    fs.write((char *) &count, sizeof(count));
-    //printf("Media::serialize: audio streams = %i\n", count);
-    for (auto &stream : audios) {
-        // id
-        fs.write((char *) &stream.id, sizeof(stream.id));
-        // type
-        size = stream.type.size();
-        fs.write((char *) &size, sizeof(size_t));
-        fs.write((char *) stream.type.c_str(), size);
-        // title
-        size = stream.title.size();
-        fs.write((char *) &size, sizeof(size_t));
-        fs.write((char *) stream.title.c_str(), size);
-        // language
-        size = stream.language.size();
-        fs.write((char *) &size, sizeof(size_t));
-        fs.write((char *) stream.language.c_str(), size);
-        // codec
-        size = stream.codec.size();
-        fs.write((char *) &size, sizeof(size_t));
-        fs.write((char *) stream.codec.c_str(), size);
-        // rate
-        fs.write((char *) &stream.bit_rate, sizeof(stream.bit_rate));
-        fs.write((char *) &stream.sample_rate, sizeof(stream.sample_rate));
-    }
+    return mediaInfos;
+}
 
-    // subtitles streams
-    count = (int) subtitles.size();
-    fs.write((char *) &count, sizeof(count));
-    //printf("Media::serialize: subtitle streams = %i\n", count);
-    for (auto &stream : subtitles) {
-        // id
-        fs.write((char *) &stream.id, sizeof(stream.id));
-        // type
-        size = stream.type.size();
-        fs.write((char *) &size, sizeof(size_t));
-        fs.write((char *) stream.type.c_str(), size);
-        // title
-        size = stream.title.size();
-        fs.write((char *) &size, sizeof(size_t));
-        fs.write((char *) stream.title.c_str(), size);
-        // language
-        size = stream.language.size();
-        fs.write((char *) &size, sizeof(size_t));
-        fs.write((char *) stream.language.c_str(), size);
-        // codec
-        size = stream.codec.size();
-        fs.write((char *) &size, sizeof(size_t));
-        fs.write((char *) stream.codec.c_str(), size);
+bool MediaInfo::serialize(std::string *data) {
+
+    pplay::Writer w(data);
+
+    data->clear();
+    data->reserve(256);
+    data->push_back((char) MEDIA_INFO_MAGIC);
+    data->push_back((char) MEDIA_INFO_VERSION);
+
+    w.string(title);
+    w.string(path);
+    w.svarint(duration);
+    w.svarint(bit_rate);
+    w.svarint(playbackInfo.vid_id);
+    w.svarint(playbackInfo.aud_id);
+    w.svarint(playbackInfo.sub_id);
+    w.svarint(playbackInfo.position);
+    w.svarint(playbackInfo.last_played);
+
+    for (auto tracks : {&videos, &audios, &subtitles}) {
+        w.varint(tracks->size());
+        for (auto &track : *tracks) {
+            w.svarint(track.id);
+            w.string(track.type);
+            w.string(track.title);
+            w.string(track.language);
+            w.string(track.codec);
+            w.svarint(track.channels);
+            w.svarint(track.bit_rate);
+            w.svarint(track.sample_rate);
+            w.svarint(track.width);
+            w.svarint(track.height);
+        }
     }
 
-    fs.close();
+    uint32_t crc = pplay::Utility::crc32(data->data(), data->size());
+    for (int i = 0; i < 4; i++) {
+        data->push_back((char) ((crc >> (i * 8)) & 0xFF));
+    }
 
     return true;
 }
 
-bool MediaInfo::deserialize() {
+bool MediaInfo::deserialize(const uint8_t *data, size_t size) {
+
+    if (size >= 6 && data[0] == MEDIA_INFO_MAGIC && data[1] >= 2 && data[1] <= MEDIA_INFO_VERSION) {
+        uint32_t crc = 0;
+        for (int i = 0; i < 4; i++) {
+            crc |= (uint32_t) data[size - 4 + i] << (i * 8);
+        }
+        if (crc != pplay::Utility::crc32(data, size - 4)) {
+            printf("MediaInfo::deserialize: crc mismatch, dropping record\n");
+            return false;
+        }
+        return deserializeV2(data + 2, size - 6, data[1]);
+    }
 
-    int count;
-    char *data;
-    size_t size;
-    std::fstream fs;
+    // records imported from old ".info" files
+    return deserializeLegacy(data, size);
+}
 
-    fs.open(serialize_path.c_str(), std::ios::binary | std::ios::in);
-    if (!fs.is_open()) {
-        return false;
+bool MediaInfo::deserializeV2(const uint8_t *data, size_t size, int version) {
+
+    pplay::Reader r(data, size);
+    MediaInfo info;
+
+    r.string(&info.title);
+    r.string(&info.path);
+    info.duration = (long) r.svarint();
+    info.bit_rate = (int) r.svarint();
+    info.playbackInfo.vid_id = (int) r.svarint();
+    info.playbackInfo.aud_id = (int) r.svarint();
+    info.playbackInfo.sub_id = (int) r.svarint();
+    info.playbackInfo.position = (int) r.svarint();
+    if (version >= 3) {
+        info.playbackInfo.last_played = (long) r.svarint();
     }
 
-    // title
-    fs.read((char *) &size, sizeof(size));
-    data = new char[size + 1];
-    fs.read(data, size);
-    data[size] = '\0';
-    title = data;
-    delete[] data;
-    //printf("Media::deserialize: title = %s\n", title.c_str());
-
-    // path
-    fs.read((char *) &size, sizeof(size));
-    data = new char[size + 1];
-    fs.read(data, size);
-    data[size] = '\0';
-    path = data;
-    delete[] data;
-    //printf("Media::deserialize: path = %s\n", path.c_str());
-
-    // duration
-    fs.read((char *) &duration, sizeof(duration));
-    //printf("Media::deserialize: duration = %li\n", duration);
-
-    // bit rate
-    fs.read((char *) &bit_rate, sizeof(bit_rate));
-
-    // media playback status
-    fs.read((char *) &playbackInfo.vid_id, sizeof(playbackInfo.vid_id));
-    fs.read((char *) &playbackInfo.aud_id, sizeof(playbackInfo.aud_id));
-    fs.read((char *) &playbackInfo.sub_id, sizeof(playbackInfo.sub_id));
-    fs.read((char *) &playbackInfo.position, sizeof(playbackInfo.position));
-
-    // video streams
-    videos.clear();
-    fs.read((char *) &count, sizeof(count));
-    //printf("Media::deserialize: video streams = %i\n", count);
-    for (int i = 0; i < count; i++) {
-        Track stream{};
-        // id
-        fs.read((char *) &stream.id, sizeof(stream.id));
-        // type
-        fs.read((char *) &size, sizeof(size));
-        data = new char[size + 1];
-        fs.read(data, size);
-        data[size] = '\0';
-        stream.type = data;
-        // title
-        fs.read((char *) &size, sizeof(size));
-        data = new char[size + 1];
-        fs.read(data, size);
-        data[size] = '\0';
-        stream.title = data;
-        delete[] data;
-        // language
-        fs.read((char *) &size, sizeof(size));
-        data = new char[size + 1];
-        fs.read(data, size);
-        data[size] = '\0';
-        stream.language = data;
-        delete[] data;
-        // codec
-        fs.read((char *) &size, sizeof(size));
-        data = new char[size + 1];
-        fs.read(data, size);
-        data[size] = '\0';
-        stream.codec = data;
-        delete[] data;
-        // rate
-        fs.read((char *) &stream.bit_rate, sizeof(stream.bit_rate));
-        // width / height
-        fs.read((char *) &stream.width, sizeof(stream.width));
-        fs.read((char *) &stream.height, sizeof(stream.height));
-
-        videos.push_back(stream);
+    for (auto tracks : {&info.videos, &info.audios, &info.subtitles}) {
+        uint64_t count = r.varint();
+        if (!r.ok || count > MEDIA_INFO_TRACKS) {
+            return false;
+        }
+        tracks->resize((size_t) count);
+        for (auto &track : *tracks) {
+            track.id = (int) r.svarint();
+            r.string(&track.type);
+            r.string(&track.title);
+            r.string(&track.language);
+            r.string(&track.codec);
+            track.channels = (int) r.svarint();
+            track.bit_rate = (int) r.svarint();
+            track.sample_rate = (int) r.svarint();
+            track.width = (int) r.svarint();
+            track.height = (int) r.svarint();
+        }
     }
 
-    // audio streams
-    audios.clear();
-    fs.read((char *) &count, sizeof(count));
-    //printf("Media::deserialize: audio streams = %i\n", count);
-    for (int i = 0; i < count; i++) {
-        Track stream{};
-        // id
-        fs.read((char *) &stream.id, sizeof(stream.id));
-        // type
-        fs.read((char *) &size, sizeof(size));
-        data = new char[size + 1];
-        fs.read(data, size);
-        data[size] = '\0';
-        stream.type = data;
-        // title
-        fs.read((char *) &size, sizeof(size));
-        data = new char[size + 1];
-        fs.read(data, size);
-        data[size] = '\0';
-        stream.title = data;
-        delete[] data;
-        // language
-        fs.read((char *) &size, sizeof(size));
-        data = new char[size + 1];
-        fs.read(data, size);
-        data[size] = '\0';
-        stream.language = data;
-        delete[] data;
-        // codec
-        fs.read((char *) &size, sizeof(size));
-        data = new char[size + 1];
-        fs.read(data, size);
-        data[size] = '\0';
-        stream.codec = data;
-        delete[] data;
-        // rate
-        fs.read((char *) &stream.bit_rate, sizeof(stream.bit_rate));
-        fs.read((char *) &stream.sample_rate, sizeof(stream.sample_rate));
-
-        audios.push_back(stream);
+    if (!r.ok) {
+        return false;
     }
 
-    // subtitles streams
-    subtitles.clear();
-    fs.read((char *) &count, sizeof(count));
-    //printf("Media::deserialize: subtitle streams = %i\n", count);
-    for (int i = 0; i < count; i++) {
-        Track stream{};
-        // id
-        fs.read((char *) &stream.id, sizeof(stream.id));
-        // type
-        fs.read((char *) &size, sizeof(size));
-        data = new char[size + 1];
-        fs.read(data, size);
-        data[size] = '\0';
-        stream.type = data;
-        // title
-        fs.read((char *) &size, sizeof(size));
-        data = new char[size + 1];
-        fs.read(data, size);
-        data[size] = '\0';
-        stream.title = data;
-        delete[] data;
-        // language
-        fs.read((char *) &size, sizeof(size));
-        data = new char[size + 1];
-        fs.read(data, size);
-        data[size] = '\0';
-        stream.language = data;
-        delete[] data;
-        // codec
-        fs.read((char *) &size, sizeof(size));
-        data = new char[size + 1];
-        fs.read(data, size);
-        data[size] = '\0';
-        stream.codec = data;
-        delete[] data;
-
-        subtitles.push_back(stream);
+    *this = std::move(info);
+
+    return true;
+}
+
+bool MediaInfo::deserializeLegacy(const uint8_t *data, size_t size) {
+
+    pplay::Reader r(data, size);
+    MediaInfo info;
+
+    r.rawString(&info.title);
+    r.rawString(&info.path);
+    info.duration = r.raw<long>();
+    info.bit_rate = r.raw<int>();
+    info.playbackInfo.vid_id = r.raw<int>();
+    info.playbackInfo.aud_id = r.raw<int>();
+    info.playbackInfo.sub_id = r.raw<int>();
+    info.playbackInfo.position = r.raw<int>();
+
+    int type = 0;
+    for (auto tracks : {&info.videos, &info.audios, &info.subtitles}) {
+        auto count = r.raw<int>();
+        if (!r.ok || count < 0 || count > MEDIA_INFO_TRACKS) {
+            return false;
+        }
+        tracks->resize((size_t) count);
+        for (auto &track : *tracks) {
+            track.id = r.raw<int>();
+            r.rawString(&track.type);
+            r.rawString(&track.title);
+            r.rawString(&track.language);
+            r.rawString(&track.codec);
+            if (type == 0) {
+                track.bit_rate = r.raw<int>();
+                track.width = r.raw<int>();
+                track.height = r.raw<int>();
+            } else if (type == 1) {
+                track.bit_rate = r.raw<int>();
+                track.sample_rate = r.raw<int>();
+            }
+        }
+        type++;
+    }
+
+    if (!r.ok) {
+        return false;
     }
 
-    fs.close();
+    *this = std::move(info);
 
     return true;
 }
@@ -5,6 +5,7 @@
 #ifndef PPLAY_MEDIA_INFO_H
 #define PPLAY_MEDIA_INFO_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -34,6 +35,8 @@ public:
         int aud_id = -1;
         int sub_id = -1;
         int position = 0;
+        // unix time, 0 if never played
+        long last_played = 0;
     };
 
     MediaInfo() = default;
@@ -42,6 +45,9 @@ public:
 
     void save(const c2d::Io::File &file);
 
+    // load media info of many files at once (directory listing)
+    static std::vector<MediaInfo> load(const std::vector<c2d::Io::File> &files);
+
     // media information
     std::string title = "Unknown";
     std::string path;
@@ -55,11 +61,15 @@ public:
 
 private:
 
-    std::string serialize_path;
+    bool serialize(std::string *data);
+
+    // corrupted or truncated records are rejected, leaving this untouched
+    bool deserialize(const uint8_t *data, size_t size);
 
-    bool serialize();
+    // v2 and later
+    bool deserializeV2(const uint8_t *data, size_t size, int version);
 
-    bool deserialize();
+    bool deserializeLegacy(const uint8_t *data, size_t size);
 
     void debut_print();
 };
@@ -0,0 +1,396 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include <cstring>
+#include <cstdlib>
+
+#if !defined(__SWITCH__) && !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+#ifdef _WIN32
+// not <io.h>, src/io.h would be picked instead
+#include <corecrt_io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "cross2d/c2d.h"
+#include "media_store.h"
+#include "utility.h"
+
+#define STORE_MAGIC         0x534D5050  // "PPMS"
+#define STORE_VERSION       1
+#define STORE_HEADER_SIZE   8
+#define RECORD_MAGIC        0x43455250  // "PREC"
+// magic, size, key, crc
+#define RECORD_HEADER_SIZE  20
+#define RECORD_SIZE_MAX     (1024 * 1024)
+// compact when dead records take more than live ones (and this much)
+#define COMPACT_MIN_SIZE    (256 * 1024)
+
+using namespace pplay;
+
+static uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static bool truncate_file(FILE *fp, uint64_t size) {
+#ifdef _WIN32
+    return _chsize_s(_fileno(fp), (__int64) size) == 0;
+#else
+    return ftruncate(fileno(fp), (off_t) size) == 0;
+#endif
+}
+
+static std::string make_record(uint64_t key, const void *data, size_t length) {
+
+    std::string record(RECORD_HEADER_SIZE, '\0');
+    uint32_t magic = RECORD_MAGIC;
+    auto size = (uint32_t) length;
+    uint32_t crc = Utility::crc32(&key, 8);
+    crc = Utility::crc32(data, length, crc);
+
+    memcpy(&record[0], &magic, 4);
+    memcpy(&record[4], &size, 4);
+    memcpy(&record[8], &key, 8);
+    memcpy(&record[16], &crc, 4);
+    record.append((const char *) data, length);
+
+    return record;
+}
+
+MediaStore::MediaStore(const std::string &p) {
+
+    path = p;
+    mutex = SDL_CreateMutex();
+
+    bool created = false;
+    if (open(&created) && created) {
+        std::string cachePath = path.substr(0, path.find_last_of('/') + 1);
+        int count = migrate(cachePath);
+        if (count > 0) {
+            printf("MediaStore: migrated %i media info files\n", count);
+        }
+    }
+}
+
+MediaStore *MediaStore::getInstance() {
+    static MediaStore store(c2d_renderer->getIo()->getDataPath() + "cache/media.db");
+    return &store;
+}
+
+bool MediaStore::open(bool *created) {
+
+    // interrupted compaction
+    std::string tmp = path + ".tmp";
+    if (!c2d_renderer->getIo()->exist(path) && c2d_renderer->getIo()->exist(tmp)) {
+        rename(tmp.c_str(), path.c_str());
+    }
+
+    fp = fopen(path.c_str(), "r+b");
+    if (!fp) {
+        fp = fopen(path.c_str(), "w+b");
+        if (!fp) {
+            printf("MediaStore::open: could not create %s\n", path.c_str());
+            return false;
+        }
+        uint32_t header[2] = {STORE_MAGIC, STORE_VERSION};
+        fwrite(header, 1, STORE_HEADER_SIZE, fp);
+        fflush(fp);
+        if (created) {
+            *created = true;
+        }
+    }
+
+    fseeko(fp, 0, SEEK_END);
+    fileSize = (uint64_t) ftello(fp);
+
+    // file image, records are read from memory
+    imageSize = (size_t) fileSize;
+#if !defined(__SWITCH__) && !defined(_WIN32)
+    void *map = mmap(nullptr, imageSize, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+    if (map != MAP_FAILED) {
+        image = (uint8_t *) map;
+        mapSize = imageSize;
+        mapped = true;
+    }
+#endif
+    if (!mapped) {
+        image = (uint8_t *) malloc(imageSize);
+        fseeko(fp, 0, SEEK_SET);
+        if (!image || fread(image, 1, imageSize, fp) != imageSize) {
+            imageSize = 0;
+        }
+    }
+
+    if (imageSize < STORE_HEADER_SIZE
+        || read32(image) != STORE_MAGIC || read32(image + 4) != STORE_VERSION) {
+        printf("MediaStore::open: invalid store, resetting\n");
+        close();
+        if (remove(path.c_str()) != 0) {
+            return false;
+        }
+        return open(created);
+    }
+
+    // build index, stop at first incomplete/corrupted record (crash while writing)
+    index.clear();
+    liveSize = 0;
+    size_t pos = STORE_HEADER_SIZE;
+    while (pos + RECORD_HEADER_SIZE <= imageSize) {
+        const uint8_t *p = image + pos;
+        uint32_t size = read32(p + 4);
+        if (read32(p) != RECORD_MAGIC || size > RECORD_SIZE_MAX
+            || pos + RECORD_HEADER_SIZE + size > imageSize) {
+            break;
+        }
+        uint64_t key = read64(p + 8);
+        uint32_t crc = Utility::crc32(p + 8, 8);
+        crc = Utility::crc32(p + RECORD_HEADER_SIZE, size, crc);
+        if (crc != read32(p + 16)) {
+            break;
+        }
+        auto it = index.find(key);
+        if (it != index.end()) {
+            liveSize -= it->second.size + RECORD_HEADER_SIZE;
+        }
+        index[key] = {pos + RECORD_HEADER_SIZE, size};
+        liveSize += size + RECORD_HEADER_SIZE;
+        pos += RECORD_HEADER_SIZE + size;
+    }
+
+    if (pos < imageSize) {
+        printf("MediaStore::open: dropping %lu bytes of incomplete records\n", (unsigned long) (imageSize - pos));
+        if (truncate_file(fp, pos)) {
+            fileSize = pos;
+            imageSize = pos;
+        }
+    }
+
+    fseeko(fp, 0, SEEK_END);
+    printf("MediaStore::open: %lu records (%lu bytes)\n", (unsigned long) index.size(), (unsigned long) fileSize);
+
+    return true;
+}
+
+void MediaStore::close() {
+
+    if (image) {
+#if !defined(__SWITCH__) && !defined(_WIN32)
+        if (mapped) {
+            munmap(image, mapSize);
+        } else
+#endif
+        {
+            free(image);
+        }
+    }
+    image = nullptr;
+    imageSize = 0;
+    mapSize = 0;
+    mapped = false;
+    tail.clear();
+
+    if (fp) {
+        fclose(fp);
+        fp = nullptr;
+    }
+}
+
+const uint8_t *MediaStore::read(const Entry &entry) {
+
+    if (entry.offset + entry.size <= imageSize) {
+        return image + entry.offset;
+    }
+
+    // appended after open
+    uint64_t offset = entry.offset - imageSize;
+    if (offset + entry.size <= tail.size()) {
+        return tail.data() + offset;
+    }
+
+    return nullptr;
+}
+
+bool MediaStore::get(uint64_t key, const Reader &reader) {
+
+    SDL_LockMutex(mutex);
+    const uint8_t *data = nullptr;
+    auto it = index.find(key);
+    if (it != index.end() && (data = read(it->second))) {
+        reader(data, it->second.size);
+    }
+    SDL_UnlockMutex(mutex);
+
+    return data != nullptr;
+}
+
+int MediaStore::get(const std::vector<uint64_t> &keys, const BatchReader &reader) {
+
+    int found = 0;
+
+    SDL_LockMutex(mutex);
+    for (size_t i = 0; i < keys.size(); i++) {
+        const uint8_t *data;
+        auto it = index.find(keys[i]);
+        if (it != index.end() && (data = read(it->second))) {
+            reader(i, data, it->second.size);
+            found++;
+        }
+    }
+    SDL_UnlockMutex(mutex);
+
+    return found;
+}
+
+bool MediaStore::put(uint64_t key, const std::string &data) {
+
+    if (data.size() > RECORD_SIZE_MAX) {
+        return false;
+    }
+
+    std::string record = make_record(key, data.data(), data.size());
+
+    SDL_LockMutex(mutex);
+
+    if (!fp) {
+        SDL_UnlockMutex(mutex);
+        return false;
+    }
+
+    // single write, the record is only valid once complete (crc)
+    fseeko(fp, 0, SEEK_END);
+    if (fwrite(record.data(), 1, record.size(), fp) != record.size() || fflush(fp) != 0) {
+        printf("MediaStore::put: write failed\n");
+        // drop the partial record so next appends stay readable
+        if (!truncate_file(fp, fileSize)) {
+            printf("MediaStore::put: truncate failed\n");
+        }
+        SDL_UnlockMutex(mutex);
+        return false;
+    }
+
+    auto it = index.find(key);
+    if (it != index.end()) {
+        liveSize -= it->second.size + RECORD_HEADER_SIZE;
+    }
+    index[key] = {fileSize + RECORD_HEADER_SIZE, (uint32_t) data.size()};
+    liveSize += record.size();
+    tail.insert(tail.end(), record.begin(), record.end());
+    fileSize += record.size();
+
+    uint64_t dead = fileSize - STORE_HEADER_SIZE - liveSize;
+    bool needCompact = dead > COMPACT_MIN_SIZE && dead > liveSize;
+
+    SDL_UnlockMutex(mutex);
+
+    if (needCompact) {
+        compact();
+    }
+
+    return true;
+}
+
+bool MediaStore::compact() {
+
+    SDL_LockMutex(mutex);
+
+    std::string tmp = path + ".tmp";
+    FILE *out = fopen(tmp.c_str(), "wb");
+    if (!out) {
+        SDL_UnlockMutex(mutex);
+        return false;
+    }
+
+    bool success = true;
+    uint32_t header[2] = {STORE_MAGIC, STORE_VERSION};
+    fwrite(header, 1, STORE_HEADER_SIZE, out);
+    for (auto &entry : index) {
+        const uint8_t *data = read(entry.second);
+        if (!data) {
+            continue;
+        }
+        std::string record = make_record(entry.first, data, entry.second.size);
+        if (fwrite(record.data(), 1, record.size(), out) != record.size()) {
+            success = false;
+            break;
+        }
+    }
+
+    success = fflush(out) == 0 && success;
+#if !defined(__SWITCH__) && !defined(_WIN32)
+    success = fsync(fileno(out)) == 0 && success;
+#elif defined(_WIN32)
+    success = _commit(_fileno(out)) == 0 && success;
+#endif
+    fclose(out);
+
+    if (!success) {
+        remove(tmp.c_str());
+        SDL_UnlockMutex(mutex);
+        return false;
+    }
+
+    uint64_t oldSize = fileSize;
+    close();
+#ifdef __SWITCH__
+    // fat: rename doesn't replace existing files (tmp is recovered by open if we stop here)
+    remove(path.c_str());
+#endif
+    rename(tmp.c_str(), path.c_str());
+    open();
+
+    printf("MediaStore::compact: %lu -> %lu bytes\n", (unsigned long) oldSize, (unsigned long) fileSize);
+
+    SDL_UnlockMutex(mutex);
+
+    return true;
+}
+
+int MediaStore::migrate(const std::string &cachePath) {
+
+    int count = 0;
+    std::vector<c2d::Io::File> files = c2d_renderer->getIo()->getDirList(cachePath);
+
+    for (auto &file : files) {
+        if (file.type != c2d::Io::Type::File || !c2d::Utility::endsWith(file.name, ".info")) {
+            continue;
+        }
+
+        // old files are named from path hash, which is our key
+        uint64_t key = strtoull(file.name.c_str(), nullptr, 10);
+        FILE *in = fopen(file.path.c_str(), "rb");
+        if (!in) {
+            continue;
+        }
+
+        std::string data;
+        char buffer[4096];
+        size_t len;
+        while ((len = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+            data.append(buffer, len);
+        }
+        fclose(in);
+
+        if (put(key, data)) {
+            remove(file.path.c_str());
+            count++;
+        }
+    }
+
+    return count;
+}
+
+MediaStore::~MediaStore() {
+    close();
+    SDL_DestroyMutex(mutex);
+}
@@ -0,0 +1,79 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_MEDIA_STORE_H
+#define PPLAY_MEDIA_STORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <SDL2/SDL_thread.h>
+
+namespace pplay {
+
+    // single append-only file holding all media info records ("cache/media.db"),
+    // replacing the one file per media "cache/<hash>.info". A record is only
+    // visible once fully written (checksum), latest record of a key wins.
+    class MediaStore {
+
+    public:
+
+        // record data is only valid during the call (no copy, store is locked)
+        typedef std::function<void(const uint8_t *data, size_t size)> Reader;
+        typedef std::function<void(size_t index, const uint8_t *data, size_t size)> BatchReader;
+
+        explicit MediaStore(const std::string &path);
+
+        ~MediaStore();
+
+        // shared instance, in data path cache directory
+        static MediaStore *getInstance();
+
+        bool get(uint64_t key, const Reader &reader);
+
+        // one lock for all keys (directory listing), reader is called for found keys only
+        int get(const std::vector<uint64_t> &keys, const BatchReader &reader);
+
+        bool put(uint64_t key, const std::string &data);
+
+        // rewrite live records only
+        bool compact();
+
+        // import old "<hash>.info" files from cache directory
+        int migrate(const std::string &cachePath);
+
+    private:
+
+        class Entry {
+        public:
+            uint64_t offset;
+            uint32_t size;
+        };
+
+        // created: new (empty) store file
+        bool open(bool *created = nullptr);
+
+        void close();
+
+        const uint8_t *read(const Entry &entry);
+
+        std::string path;
+        FILE *fp = nullptr;
+        SDL_mutex *mutex = nullptr;
+        std::unordered_map<uint64_t, Entry> index;
+        // file image: mapped (or read) at open, then records appended since
+        uint8_t *image = nullptr;
+        size_t imageSize = 0;
+        size_t mapSize = 0;
+        bool mapped = false;
+        std::vector<uint8_t> tail;
+        uint64_t fileSize = 0;
+        uint64_t liveSize = 0;
+    };
+}
+
+#endif //PPLAY_MEDIA_STORE_H
@@ -13,6 +13,7 @@ MenuMain::MenuMain(Main *main, const c2d::FloatRect &rect, const std::vector<Men
     std::vector<MenuItem> it;
 
     it.emplace_back(OPT_CPU_BOOST, "cpu.png", MenuItem::Position::Top);
+    it.emplace_back(OPT_FRAME_PACING, "video.png", MenuItem::Position::Top);
 #ifdef __SWITCH__
     it.emplace_back(OPT_UMS_DEVICE, "usb.png", MenuItem::Position::Top);
 #endif
@@ -25,12 +26,23 @@ MenuMain::MenuMain(Main *main, const c2d::FloatRect &rect, const std::vector<Men
     it.clear();
     it.emplace_back("Disabled", "", MenuItem::Position::Top);
     it.emplace_back("Enabled", "", MenuItem::Position::Top);
+    it.emplace_back("Auto", "", MenuItem::Position::Top);
     menuMainOptionsCpu = new MenuMainOptionsSubmenu(main, rect, OPT_CPU_BOOST, it, OPT_CPU_BOOST);
     menuMainOptionsCpu->setLayer(2);
     menuMainOptionsCpu->setVisibility(Visibility::Hidden, false);
     menuMainOptionsCpu->setSelection(main->getConfig()->getOption(OPT_CPU_BOOST)->getString());
     main->add(menuMainOptionsCpu);
 
+    // Frame pacing
+    it.clear();
+    it.emplace_back("Disabled", "", MenuItem::Position::Top);
+    it.emplace_back("Enabled", "", MenuItem::Position::Top);
+    menuMainOptionsPacing = new MenuMainOptionsSubmenu(main, rect, OPT_FRAME_PACING, it, OPT_FRAME_PACING);
+    menuMainOptionsPacing->setLayer(2);
+    menuMainOptionsPacing->setVisibility(Visibility::Hidden, false);
+    menuMainOptionsPacing->setSelection(main->getConfig()->getOption(OPT_FRAME_PACING)->getString());
+    main->add(menuMainOptionsPacing);
+
 #ifdef __SWITCH__
     std::string umsPath;
     it.clear();
@@ -53,6 +65,9 @@ void MenuMain::onOptionSelection(MenuItem *item) {
     } else if (item->name == "Network") {
         setVisibility(Visibility::Hidden, true);
         main->show(Main::MenuType::Network);
+    } else if (item->name == "Search") {
+        setVisibility(Visibility::Hidden, true);
+        main->getFiler()->searchLibrary();
     } else if (item->name == "Options") {
         setVisibility(Visibility::Hidden, true);
         menuMainOptions->setVisibility(Visibility::Visible);
@@ -88,6 +103,7 @@ bool MenuMain::isMenuVisible() {
     return isVisible()
            || menuMainOptions->isVisible()
            || menuMainOptionsCpu->isVisible()
+           || menuMainOptionsPacing->isVisible()
            #ifdef __SWITCH__
            || menuMainOptionsUsb->isVisible()
 #endif
@@ -102,6 +118,9 @@ MenuMainOptionsSubmenu *MenuMain::getMenuMainOptionsSubmenu(const std::string &n
     if (name == OPT_CPU_BOOST) {
         return menuMainOptionsCpu;
     }
+    if (name == OPT_FRAME_PACING) {
+        return menuMainOptionsPacing;
+    }
 #ifdef __SWITCH__
     if (name == OPT_UMS_DEVICE) {
         return menuMainOptionsUsb;
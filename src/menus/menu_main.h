@@ -29,6 +29,7 @@ private:
 
     MenuMainOptions *menuMainOptions;
     MenuMainOptionsSubmenu *menuMainOptionsCpu;
+    MenuMainOptionsSubmenu *menuMainOptionsPacing;
 #ifdef __SWITCH__
     MenuMainOptionsSubmenu *menuMainOptionsUsb;
 #endif
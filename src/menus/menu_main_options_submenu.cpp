@@ -40,11 +40,9 @@ void MenuMainOptionsSubmenu::setSelection(const std::string &name) {
 void MenuMainOptionsSubmenu::onOptionSelection(MenuItem *item) {
 
     if (option_name == OPT_CPU_BOOST) {
-        if (item->name == "Enabled") {
-            pplay::Utility::setCpuClock(pplay::Utility::CpuClock::Max);
-        } else {
-            pplay::Utility::setCpuClock(pplay::Utility::CpuClock::Min);
-        }
+        main->getPlayer()->setCpuBoost(item->name);
+    } else if (option_name == OPT_FRAME_PACING) {
+        main->getPlayer()->setFramePacing(item->name == "Enabled");
     }
 
     main->getConfig()->getOption(option_name)->setString(item->name);
@@ -2,6 +2,8 @@
 // Created by cpasjuste on 02/04/19.
 //
 
+#include <chrono>
+#include <algorithm>
 #include <SDL2/SDL_video.h>
 #include "mpv.h"
 
@@ -9,7 +11,7 @@ static void *get_proc_address_mpv(void *unused, const char *name) {
     return SDL_GL_GetProcAddress(name);
 }
 
-Mpv::Mpv(const std::string &configPath, bool initRender) {
+Mpv::Mpv(const std::string &configPath, bool initRender, bool softwareRender) {
 
     handle = mpv_create();
     if (!handle) {
@@ -21,9 +23,6 @@ Mpv::Mpv(const std::string &configPath, bool initRender) {
     mpv_set_option_string(handle, "config-dir", configPath.c_str());
     mpv_set_option_string(handle, "terminal", "yes");
     //mpv_set_option_string(handle, "msg-level", "all=v");
-    mpv_set_option_string(handle, "vd-lavc-threads", "4");
-    mpv_set_option_string(handle, "vd-lavc-fast", "yes");
-    mpv_set_option_string(handle, "vd-lavc-skiploopfilter", "all");
     mpv_set_option_string(handle, "audio-channels", "stereo");
     if (!initRender) {
         mpv_set_option_string(handle, "vid", "no");
@@ -41,6 +40,19 @@ Mpv::Mpv(const std::string &configPath, bool initRender) {
         return;
     }
 
+    // properties used by the ui, see onPropertyChange
+    mpv_observe_property(handle, Property::PlaybackTime, "playback-time", MPV_FORMAT_DOUBLE);
+    mpv_observe_property(handle, Property::Duration, "duration", MPV_FORMAT_DOUBLE);
+    mpv_observe_property(handle, Property::Speed, "speed", MPV_FORMAT_DOUBLE);
+    mpv_observe_property(handle, Property::Pause, "pause", MPV_FORMAT_FLAG);
+    mpv_observe_property(handle, Property::PlaybackAbort, "playback-abort", MPV_FORMAT_FLAG);
+    mpv_observe_property(handle, Property::ContainerFps, "container-fps", MPV_FORMAT_DOUBLE);
+    mpv_observe_property(handle, Property::DecoderDropCount, "decoder-frame-drop-count", MPV_FORMAT_INT64);
+    mpv_observe_property(handle, Property::FrameDropCount, "frame-drop-count", MPV_FORMAT_INT64);
+    mpv_observe_property(handle, Property::DelayedFrameCount, "vo-delayed-frame-count", MPV_FORMAT_INT64);
+    mpv_observe_property(handle, Property::VideoWidth, "video-params/w", MPV_FORMAT_INT64);
+    mpv_observe_property(handle, Property::VideoHeight, "video-params/h", MPV_FORMAT_INT64);
+
     if (initRender) {
         mpv_opengl_init_params gl_init_params{get_proc_address_mpv, nullptr, nullptr};
         mpv_render_param params[]{
@@ -48,17 +60,27 @@ Mpv::Mpv(const std::string &configPath, bool initRender) {
                 {MPV_RENDER_PARAM_OPENGL_INIT_PARAMS, &gl_init_params},
                 {MPV_RENDER_PARAM_INVALID,            nullptr}
         };
+        mpv_render_param sw_params[]{
+                {MPV_RENDER_PARAM_API_TYPE, const_cast<char *>(MPV_RENDER_API_TYPE_SW)},
+                {MPV_RENDER_PARAM_INVALID,  nullptr}
+        };
 
-        if (mpv_render_context_create(&context, handle, params) < 0) {
+        software = softwareRender;
+        res = mpv_render_context_create(&context, handle, software ? sw_params : params);
+        if (res < 0) {
             printf("error: mpv_render_context_create: %s\n", mpv_error_string(res));
             mpv_terminate_destroy(handle);
             handle = nullptr;
+            return;
         }
+
+        mpv_render_context_set_update_callback(context, onRenderUpdate, this);
     }
 }
 
 Mpv::~Mpv() {
     if (context) {
+        mpv_render_context_set_update_callback(context, nullptr, nullptr);
         mpv_render_context_free(context);
     }
     if (handle) {
@@ -66,7 +88,8 @@ Mpv::~Mpv() {
     }
 }
 
-int Mpv::load(const std::string &file, LoadType loadType, const std::string &options) {
+int Mpv::load(const std::string &file, LoadType loadType,
+              const std::string &options, const Callback &callback) {
 
     if (handle) {
         std::string type = "replace";
@@ -75,61 +98,158 @@ int Mpv::load(const std::string &file, LoadType loadType, const std::string &opt
         } else if (loadType == LoadType::AppendPlay) {
             type = "append-play";
         }
-        const char *cmd[] = {"loadfile", file.c_str(), type.c_str(), options.c_str(), nullptr};
-        return mpv_command(handle, cmd);
+        return command(Command::Load, {"loadfile", file, type, options}, callback);
     }
 
     return -1;
 }
 
 int Mpv::pause() {
-    return mpv_command_string(handle, "set pause yes");
+    int res = mpv_command_string(handle, "set pause yes");
+    if (res == 0) {
+        paused = true;
+    }
+    return res;
 }
 
 int Mpv::resume() {
-    return mpv_command_string(handle, "set pause no");
+    int res = mpv_command_string(handle, "set pause no");
+    if (res == 0) {
+        paused = false;
+    }
+    return res;
 }
 
 int Mpv::stop() {
     return mpv_command_string(handle, "stop");
 }
 
-int Mpv::seek(double position) {
-    std::string cmd = "no-osd seek " + std::to_string(position) + " absolute";
-    return mpv_command_string(handle, cmd.c_str());
+int Mpv::seek(double position, const Callback &callback) {
+    return command(Command::Seek, {"no-osd", "seek", std::to_string(position), "absolute"}, callback);
 }
 
-int Mpv::setSpeed(double speed) {
-    std::string cmd = "set speed " + std::to_string(speed);
-    return mpv_command_string(handle, cmd.c_str());
+int Mpv::setSpeed(double speed, const Callback &callback) {
+    int res = command(Command::Speed, {"set", "speed", std::to_string(speed)}, callback);
+    if (res == 0) {
+        // don't wait for the property change, allow successive speed changes
+        this->speed = speed;
+    }
+    return res;
 }
 
 double Mpv::getSpeed() {
-    double res = -1;
-    mpv_get_property(handle, "speed", MPV_FORMAT_DOUBLE, &res);
-    return res;
+    return speed;
+}
+
+double Mpv::getFps() {
+    return fps;
+}
+
+int Mpv::getVideoWidth() {
+    return videoWidth;
+}
+
+int Mpv::getVideoHeight() {
+    return videoHeight;
+}
+
+long Mpv::getDecoderDropCount() {
+    return decoderDrops;
+}
+
+long Mpv::getFrameDropCount() {
+    return frameDrops;
+}
+
+long Mpv::getDelayedFrameCount() {
+    return delayedFrames;
+}
+
+void Mpv::setDecoderShortcuts(bool enable) {
+
+    mpv_set_property_string(handle, "vd-lavc-fast", enable ? "yes" : "no");
+    mpv_set_property_string(handle, "vd-lavc-skiploopfilter", enable ? "all" : "default");
+
+    // only read on decoder init, reselect the video track once to re-create the decoder
+    // (short stall, callers rate limit this)
+    char *vid = mpv_get_property_string(handle, "vid");
+    if (vid) {
+        std::string id = vid;
+        mpv_free(vid);
+        if (id != "no") {
+            command(Command::Video, {"no-osd", "set", "vid", "no"}, [this, id](int error) {
+                command(Command::Video, {"no-osd", "set", "vid", id}, nullptr);
+            });
+        }
+    }
 }
 
-int Mpv::setVid(int id) {
+int Mpv::setVid(int id, const Callback &callback) {
     if (id > -1) {
-        std::string cmd = "no-osd set vid " + std::to_string(id);
-        return mpv_command_string(handle, cmd.c_str());
+        return command(Command::Video, {"no-osd", "set", "vid", std::to_string(id)}, callback);
     }
     return -1;
 }
 
-int Mpv::setAid(int id) {
+int Mpv::setAid(int id, const Callback &callback) {
     if (id > -1) {
-        std::string cmd = "no-osd set aid " + std::to_string(id);
-        return mpv_command_string(handle, cmd.c_str());
+        return command(Command::Audio, {"no-osd", "set", "aid", std::to_string(id)}, callback);
     }
     return -1;
 }
 
-int Mpv::setSid(int id) {
-    std::string cmd = "no-osd set sid ";
-    cmd += id < 0 ? "no" : std::to_string(id);
-    return mpv_command_string(handle, cmd.c_str());
+int Mpv::setSid(int id, const Callback &callback) {
+    return command(Command::Subtitle, {"no-osd", "set", "sid", id < 0 ? "no" : std::to_string(id)}, callback);
+}
+
+int Mpv::command(Command type, const std::vector<std::string> &args, const Callback &callback) {
+
+    if (!handle) {
+        return -1;
+    }
+
+    // abort the superseded command, its callback will never be called
+    for (auto it = commands.begin(); it != commands.end(); ++it) {
+        if (it->type == type) {
+            mpv_abort_async_command(handle, it->id);
+            commands.erase(it);
+            break;
+        }
+    }
+
+    std::vector<const char *> cmd;
+    for (auto &arg : args) {
+        cmd.push_back(arg.c_str());
+    }
+    cmd.push_back(nullptr);
+
+    uint64_t id = ++commandId;
+    int res = mpv_command_async(handle, id, cmd.data());
+    if (res != 0) {
+        printf("Mpv::command: %s: %s\n", args[0].c_str(), mpv_error_string(res));
+        return res;
+    }
+
+    commands.push_back({id, type, callback});
+
+    return 0;
+}
+
+void Mpv::onCommandReply(mpv_event *event) {
+
+    for (auto it = commands.begin(); it != commands.end(); ++it) {
+        if (it->id == event->reply_userdata) {
+            Callback callback = it->callback;
+            commands.erase(it);
+            if (event->error < 0) {
+                printf("Mpv::onCommandReply: %s\n", mpv_error_string(event->error));
+            }
+            if (callback) {
+                callback(event->error);
+            }
+            break;
+        }
+    }
 }
 
 int Mpv::getVideoBitrate() {
@@ -144,15 +264,11 @@ int Mpv::getAudioBitrate() {
     return (int) bitrate;
 }
 
-long Mpv::getDuration() {
-    long duration = 0;
-    mpv_get_property(handle, "duration", MPV_FORMAT_INT64, &duration);
+double Mpv::getDuration() {
     return duration;
 }
 
-long Mpv::getPosition() {
-    long position = 0;
-    mpv_get_property(handle, "playback-time", MPV_FORMAT_INT64, &position);
+double Mpv::getPosition() {
     return position;
 }
 
@@ -160,36 +276,183 @@ bool Mpv::isAvailable() {
     return handle != nullptr;
 }
 
-bool Mpv::isStopped() {
-    int res = 1;
-    mpv_get_property(handle, "playback-abort", MPV_FORMAT_FLAG, &res);
-    return res == 1;
+bool Mpv::isStopped(bool sync) {
+    if (sync) {
+        // cached value may be outdated when handling END_FILE (replace)
+        int res = 1;
+        mpv_get_property(handle, "playback-abort", MPV_FORMAT_FLAG, &res);
+        stopped = res == 1;
+    }
+    return stopped;
 }
 
 bool Mpv::isPaused() {
-    int res = -1;
-    mpv_get_property(handle, "pause", MPV_FORMAT_FLAG, &res);
-    return res == 1;
+    return paused;
 }
 
-mpv_event *Mpv::getEvent() {
-    return mpv_wait_event(handle, 0);
+int Mpv::pollEvents(const std::function<void(mpv_event *event)> &callback, double timeout) {
+
+    auto start = std::chrono::steady_clock::now();
+    int count = 0;
+
+    // drain the whole queue, a single event per frame makes
+    // FILE_LOADED/END_FILE lag behind under bursts (seek, tracks switch..)
+    while (true) {
+        // only wait for the first event (headless instances on worker threads)
+        mpv_event *event = mpv_wait_event(handle, count == 0 ? timeout : 0);
+        if (event->event_id == MPV_EVENT_NONE) {
+            break;
+        }
+        count++;
+        if (event->event_id == MPV_EVENT_PROPERTY_CHANGE) {
+            onPropertyChange(event);
+        } else if (event->event_id == MPV_EVENT_COMMAND_REPLY) {
+            onCommandReply(event);
+        } else if (event->event_id == MPV_EVENT_QUEUE_OVERFLOW) {
+            // some events were dropped, property changes may be lost
+            eventStats.overflows++;
+            printf("Mpv::pollEvents: event queue overflow (%lu)\n", eventStats.overflows);
+            syncProperties();
+        }
+        // callback may poll again (message box loop), don't use event after this
+        callback(event);
+    }
+
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    eventStats.events += (unsigned long) count;
+    eventStats.depth = count;
+    eventStats.depth_max = std::max(eventStats.depth_max, count);
+    eventStats.latency = elapsed.count();
+    eventStats.latency_max = std::max(eventStats.latency_max, eventStats.latency);
+
+    return count;
+}
+
+const Mpv::EventStats &Mpv::getEventStats() const {
+    return eventStats;
+}
+
+void Mpv::onPropertyChange(mpv_event *event) {
+
+    auto property = (mpv_event_property *) event->data;
+    // MPV_FORMAT_NONE: property unavailable (no file loaded..)
+    bool available = property->format != MPV_FORMAT_NONE;
+
+    switch (event->reply_userdata) {
+        case Property::PlaybackTime:
+            position = available ? *(double *) property->data : 0;
+            break;
+        case Property::Duration:
+            duration = available ? *(double *) property->data : 0;
+            break;
+        case Property::Speed:
+            speed = available ? *(double *) property->data : 1;
+            break;
+        case Property::Pause:
+            paused = available && *(int *) property->data == 1;
+            break;
+        case Property::PlaybackAbort:
+            stopped = !available || *(int *) property->data == 1;
+            break;
+        case Property::ContainerFps:
+            fps = available ? *(double *) property->data : 0;
+            break;
+        case Property::DecoderDropCount:
+            decoderDrops = available ? (long) *(int64_t *) property->data : 0;
+            break;
+        case Property::FrameDropCount:
+            frameDrops = available ? (long) *(int64_t *) property->data : 0;
+            break;
+        case Property::DelayedFrameCount:
+            delayedFrames = available ? (long) *(int64_t *) property->data : 0;
+            break;
+        case Property::VideoWidth:
+            videoWidth = available ? (int) *(int64_t *) property->data : 0;
+            break;
+        case Property::VideoHeight:
+            videoHeight = available ? (int) *(int64_t *) property->data : 0;
+            break;
+        default:
+            break;
+    }
+}
+
+void Mpv::syncProperties() {
+
+    double value = 0;
+    int flag = 0;
+
+    position = mpv_get_property(handle, "playback-time", MPV_FORMAT_DOUBLE, &value) == 0 ? value : 0;
+    duration = mpv_get_property(handle, "duration", MPV_FORMAT_DOUBLE, &value) == 0 ? value : 0;
+    speed = mpv_get_property(handle, "speed", MPV_FORMAT_DOUBLE, &value) == 0 ? value : 1;
+    paused = mpv_get_property(handle, "pause", MPV_FORMAT_FLAG, &flag) == 0 && flag == 1;
+    stopped = mpv_get_property(handle, "playback-abort", MPV_FORMAT_FLAG, &flag) != 0 || flag == 1;
+    fps = mpv_get_property(handle, "container-fps", MPV_FORMAT_DOUBLE, &value) == 0 ? value : 0;
+    int64_t count = 0;
+    decoderDrops = mpv_get_property(handle, "decoder-frame-drop-count", MPV_FORMAT_INT64, &count) == 0 ? count : 0;
+    frameDrops = mpv_get_property(handle, "frame-drop-count", MPV_FORMAT_INT64, &count) == 0 ? count : 0;
+    delayedFrames = mpv_get_property(handle, "vo-delayed-frame-count", MPV_FORMAT_INT64, &count) == 0 ? count : 0;
+    videoWidth = mpv_get_property(handle, "video-params/w", MPV_FORMAT_INT64, &count) == 0 ? (int) count : 0;
+    videoHeight = mpv_get_property(handle, "video-params/h", MPV_FORMAT_INT64, &count) == 0 ? (int) count : 0;
 }
 
 mpv_handle *Mpv::getHandle() {
     return handle;
 }
 
+bool Mpv::isSoftware() {
+    return software;
+}
+
 mpv_render_context *Mpv::getContext() {
     return context;
 }
 
+void Mpv::onRenderUpdate(void *ctx) {
+    // called from mpv threads, mpv api can't be used here
+    ((Mpv *) ctx)->renderUpdate = true;
+}
+
+bool Mpv::hasNewFrame() {
+
+    if (!context || !renderUpdate.exchange(false)) {
+        return false;
+    }
+
+    return (mpv_render_context_update(context) & MPV_RENDER_UPDATE_FRAME) != 0;
+}
+
+void Mpv::reportSwap() {
+    if (context) {
+        mpv_render_context_report_swap(context);
+    }
+}
+
+void Mpv::setFramePacing(bool enable, double displayFps) {
+
+    if (!handle) {
+        return;
+    }
+
+    // display-resample needs the real display refresh rate, which mpv can't get from the render api
+    if (enable && displayFps > 0) {
+        std::string rate = std::to_string(displayFps);
+        if (mpv_set_property_string(handle, "display-fps-override", rate.c_str()) < 0) {
+            // mpv < 0.37
+            mpv_set_property_string(handle, "override-display-fps", rate.c_str());
+        }
+        mpv_set_property_string(handle, "video-sync", "display-resample");
+    } else {
+        mpv_set_property_string(handle, "video-sync", "audio");
+    }
+}
+
 MediaInfo Mpv::getMediaInfo(const c2d::Io::File &file) {
 
     MediaInfo mediaInfo(file);
     std::vector<MediaInfo::Track> streams;
 
-    if (!isAvailable() || isStopped()) {
+    if (!isAvailable() || isStopped(true)) {
         return mediaInfo;
     }
 
@@ -259,8 +522,10 @@ MediaInfo Mpv::getMediaInfo(const c2d::Io::File &file) {
         }
     }
 
-    // set duration
-    mediaInfo.duration = getDuration();
+    // set duration (cache may not be updated yet on FILE_LOADED)
+    double length = 0;
+    mpv_get_property(handle, "duration", MPV_FORMAT_DOUBLE, &length);
+    mediaInfo.duration = (long) length;
 
     return mediaInfo;
 }
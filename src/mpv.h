@@ -7,6 +7,9 @@
 
 #include <cstdio>
 #include <string>
+#include <atomic>
+#include <functional>
+#include <vector>
 
 #include <mpv/client.h>
 #include <mpv/render_gl.h>
@@ -22,11 +25,37 @@ public:
         AppendPlay
     };
 
-    explicit Mpv(const std::string &configPath, bool initRender);
+    // async commands, a new command of a given type supersedes (abort) the pending one
+    enum class Command {
+        Load,
+        Seek,
+        Speed,
+        Video,
+        Audio,
+        Subtitle,
+        Count
+    };
+
+    typedef std::function<void(int error)> Callback;
+
+    class EventStats {
+    public:
+        unsigned long events = 0;
+        unsigned long overflows = 0;
+        // events drained / time spent handling them (ms) on last poll
+        int depth = 0;
+        int depth_max = 0;
+        float latency = 0;
+        float latency_max = 0;
+    };
+
+    // softwareRender: use mpv "sw" render api (cpu only) instead of opengl
+    explicit Mpv(const std::string &configPath, bool initRender, bool softwareRender = false);
 
     ~Mpv();
 
-    int load(const std::string &file, LoadType loadType, const std::string &options);
+    int load(const std::string &file, LoadType loadType,
+             const std::string &options, const Callback &callback = nullptr);
 
     int pause();
 
@@ -34,44 +63,122 @@ public:
 
     int stop();
 
-    int seek(double position);
+    int seek(double position, const Callback &callback = nullptr);
 
-    int setSpeed(double speed);
+    int setSpeed(double speed, const Callback &callback = nullptr);
 
     double getSpeed();
 
-    int setVid(int id);
+    double getFps();
+
+    int getVideoWidth();
+
+    int getVideoHeight();
+
+    long getDecoderDropCount();
 
-    int setAid(int id);
+    long getFrameDropCount();
 
-    int setSid(int id);
+    long getDelayedFrameCount();
+
+    // faster, lower quality decoding, re-creates the video decoder
+    void setDecoderShortcuts(bool enable);
+
+    int setVid(int id, const Callback &callback = nullptr);
+
+    int setAid(int id, const Callback &callback = nullptr);
+
+    int setSid(int id, const Callback &callback = nullptr);
 
     int getVideoBitrate();
 
     int getAudioBitrate();
 
-    long getDuration();
+    double getDuration();
 
-    long getPosition();
+    double getPosition();
 
-    bool isStopped();
+    bool isStopped(bool sync = false);
 
     bool isPaused();
 
     bool isAvailable();
 
-    mpv_event *getEvent();
+    int pollEvents(const std::function<void(mpv_event *event)> &callback, double timeout = 0);
+
+    const EventStats &getEventStats() const;
 
     mpv_handle *getHandle();
 
     mpv_render_context *getContext();
 
+    bool isSoftware();
+
+    bool hasNewFrame();
+
+    void reportSwap();
+
+    void setFramePacing(bool enable, double displayFps);
+
     MediaInfo getMediaInfo(const c2d::Io::File &file);
 
 private:
 
+    // observed properties ids (mpv_observe_property reply_userdata)
+    enum Property {
+        PlaybackTime = 1,
+        Duration,
+        Speed,
+        Pause,
+        PlaybackAbort,
+        ContainerFps,
+        DecoderDropCount,
+        FrameDropCount,
+        DelayedFrameCount,
+        VideoWidth,
+        VideoHeight
+    };
+
+    class AsyncCommand {
+    public:
+        uint64_t id;
+        Command type;
+        Callback callback;
+    };
+
+    int command(Command type, const std::vector<std::string> &args, const Callback &callback);
+
+    void onCommandReply(mpv_event *event);
+
+    void onPropertyChange(mpv_event *event);
+
+    void syncProperties();
+
+    static void onRenderUpdate(void *ctx);
+
     mpv_handle *handle = nullptr;
     mpv_render_context *context = nullptr;
+    bool software = false;
+    EventStats eventStats;
+    std::vector<AsyncCommand> commands;
+    uint64_t commandId = 0;
+
+    // properties cache, updated from MPV_EVENT_PROPERTY_CHANGE, so the ui
+    // thread never have to wait on mpv core lock to draw the osd
+    std::atomic<double> position{0};
+    std::atomic<double> duration{0};
+    std::atomic<double> speed{1};
+    std::atomic<double> fps{0};
+    std::atomic<long> decoderDrops{0};
+    std::atomic<long> frameDrops{0};
+    std::atomic<long> delayedFrames{0};
+    std::atomic<int> videoWidth{0};
+    std::atomic<int> videoHeight{0};
+    std::atomic<bool> paused{false};
+    std::atomic<bool> stopped{true};
+
+    // set from mpv render update callback (any thread)
+    std::atomic<bool> renderUpdate{false};
 };
 
 #endif //PPLAY_MPV_H
@@ -0,0 +1,49 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include "mpv.h"
+#include "cpu_governor.h"
+
+// hysteresis: seconds of lag before boosting, seconds without lag before restoring
+#define GOVERNOR_LAG_SECONDS    2
+#define GOVERNOR_GOOD_SECONDS   20
+
+using namespace pplay;
+
+CpuGovernor::CpuGovernor(Mpv *mpv) : monitor(mpv) {
+}
+
+void CpuGovernor::setEnabled(bool enable) {
+    enabled = enable;
+    monitor.reset();
+}
+
+bool CpuGovernor::isEnabled() const {
+    return enabled;
+}
+
+void CpuGovernor::update() {
+
+    if (!enabled || !monitor.update()) {
+        return;
+    }
+
+    if (clock == Utility::CpuClock::Min && monitor.getLagSeconds() >= GOVERNOR_LAG_SECONDS) {
+        printf("CpuGovernor: decoding is lagging, raising cpu clock\n");
+        clock = Utility::CpuClock::Max;
+        Utility::setCpuClock(clock);
+    } else if (clock == Utility::CpuClock::Max && monitor.getGoodSeconds() >= GOVERNOR_GOOD_SECONDS) {
+        printf("CpuGovernor: decoding caught up, restoring cpu clock\n");
+        clock = Utility::CpuClock::Min;
+        Utility::setCpuClock(clock);
+    }
+}
+
+void CpuGovernor::reset() {
+    monitor.reset();
+    if (clock != Utility::CpuClock::Min) {
+        clock = Utility::CpuClock::Min;
+        Utility::setCpuClock(clock);
+    }
+}
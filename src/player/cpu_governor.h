@@ -0,0 +1,36 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_CPU_GOVERNOR_H
+#define PPLAY_CPU_GOVERNOR_H
+
+#include "utility.h"
+#include "lag_monitor.h"
+
+class Mpv;
+
+class CpuGovernor {
+
+public:
+
+    explicit CpuGovernor(Mpv *mpv);
+
+    void setEnabled(bool enabled);
+
+    bool isEnabled() const;
+
+    // raise cpu clock while decoding falls behind, lower it when it caught up
+    void update();
+
+    // restore min clock
+    void reset();
+
+private:
+
+    LagMonitor monitor;
+    pplay::Utility::CpuClock clock = pplay::Utility::CpuClock::Min;
+    bool enabled = false;
+};
+
+#endif //PPLAY_CPU_GOVERNOR_H
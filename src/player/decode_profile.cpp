@@ -0,0 +1,90 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include <thread>
+#include <algorithm>
+#include "mpv.h"
+#include "decode_profile.h"
+
+// seconds of lag before enabling shortcuts, seconds without lag before restoring quality
+#define PROFILE_LAG_SECONDS     3
+#define PROFILE_GOOD_SECONDS    30
+// minimum seconds between decoder re-creations (stalls playback shortly)
+#define PROFILE_RELOAD_SECONDS  10
+
+DecodeProfile::DecodeProfile(Mpv *m) : monitor(m) {
+    mpv = m;
+    good_seconds = PROFILE_GOOD_SECONDS;
+    reset();
+}
+
+int DecodeProfile::getThreads(const MediaInfo &mediaInfo) const {
+
+    int cores = (int) std::thread::hardware_concurrency();
+    if (cores < 1) {
+        cores = 4;
+    }
+
+    // unknown media, don't be greedy
+    if (mediaInfo.videos.empty()) {
+        return std::min(cores, 8);
+    }
+
+    const MediaInfo::Track &video = mediaInfo.videos[0];
+    long pixels = (long) video.width * video.height;
+    int threads;
+    if (pixels <= 1280 * 720) {
+        threads = 2;
+    } else if (pixels <= 1920 * 1080) {
+        threads = 4;
+    } else {
+        threads = 8;
+    }
+
+    // more expensive codecs
+    if (video.codec == "hevc" || video.codec == "vp9" || video.codec == "av1") {
+        threads *= 2;
+    }
+
+    // ffmpeg doesn't scale beyond 16 threads
+    return std::max(1, std::min(std::min(threads, cores), 16));
+}
+
+std::string DecodeProfile::getOptions(const MediaInfo &mediaInfo) const {
+    // lagging state is kept from previous file, restored once it plays fine
+    return "vd-lavc-threads=" + std::to_string(getThreads(mediaInfo))
+           + ",vd-lavc-fast=" + (fast ? "yes" : "no")
+           + ",vd-lavc-skiploopfilter=" + (fast ? "all" : "default");
+}
+
+void DecodeProfile::update() {
+
+    if (!monitor.update()) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - reload_time < std::chrono::seconds(PROFILE_RELOAD_SECONDS)) {
+        return;
+    }
+
+    if (!fast && monitor.getLagSeconds() >= PROFILE_LAG_SECONDS) {
+        printf("DecodeProfile: decoder is lagging, enabling fast decoding\n");
+        fast = true;
+        reload_time = now;
+        mpv->setDecoderShortcuts(true);
+    } else if (fast && monitor.getGoodSeconds() >= good_seconds) {
+        printf("DecodeProfile: decoder caught up, restoring quality\n");
+        fast = false;
+        good_seconds *= 2;
+        reload_time = now;
+        mpv->setDecoderShortcuts(false);
+    }
+}
+
+void DecodeProfile::reset() {
+    // new file: decoder was just created with getOptions state
+    monitor.reset();
+    reload_time = std::chrono::steady_clock::now();
+}
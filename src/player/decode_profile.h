@@ -0,0 +1,42 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_DECODE_PROFILE_H
+#define PPLAY_DECODE_PROFILE_H
+
+#include <chrono>
+#include <string>
+#include "media_info.h"
+#include "lag_monitor.h"
+
+class Mpv;
+
+class DecodeProfile {
+
+public:
+
+    explicit DecodeProfile(Mpv *mpv);
+
+    // per file decoder options (loadfile), based on media info when available
+    std::string getOptions(const MediaInfo &mediaInfo) const;
+
+    // enable/disable quality reducing decoder shortcuts depending on measured lag
+    void update();
+
+    // new file loaded (lagging state is kept for next files)
+    void reset();
+
+private:
+
+    int getThreads(const MediaInfo &mediaInfo) const;
+
+    Mpv *mpv = nullptr;
+    LagMonitor monitor;
+    bool fast = false;
+    // doubled each time quality is restored, to avoid flapping
+    int good_seconds = 0;
+    std::chrono::steady_clock::time_point reload_time;
+};
+
+#endif //PPLAY_DECODE_PROFILE_H
@@ -0,0 +1,104 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include <cmath>
+#include <algorithm>
+#include "mpv.h"
+#include "frame_pacer.h"
+
+// swap intervals needed before trusting the measured refresh rate
+#define PACER_MIN_SAMPLES   120
+
+FramePacer::FramePacer(Mpv *m) {
+    mpv = m;
+}
+
+void FramePacer::setEnabled(bool enable) {
+
+    enabled = enable;
+    // mpv needs the display refresh rate for display-resample, set it again once measured
+    refresh_rate_set = 0;
+    mpv->setFramePacing(enabled, enabled ? getRefreshRate() : 0);
+}
+
+bool FramePacer::isEnabled() const {
+    return enabled;
+}
+
+void FramePacer::onFrameRendered() {
+    frame_rendered = true;
+}
+
+void FramePacer::onSwap() {
+
+    auto now = std::chrono::steady_clock::now();
+    if (enabled) {
+        mpv->reportSwap();
+    }
+
+    if (!swap_time_valid) {
+        swap_time = now;
+        swap_time_valid = true;
+        return;
+    }
+
+    double elapsed = std::chrono::duration<double>(now - swap_time).count();
+    swap_time = now;
+
+    // refresh interval: average of the "good" intervals only
+    if (samples < PACER_MIN_SAMPLES ? elapsed < 0.1 : elapsed < interval * 1.5) {
+        interval = samples == 0 ? elapsed : interval + (elapsed - interval) / std::min(samples + 1, 60);
+        samples++;
+    } else if (samples >= PACER_MIN_SAMPLES && !mpv->isStopped() && !mpv->isPaused()) {
+        // we missed one or more vsync while playing (ui stalls outside playback are not counted)
+        missed += (unsigned long) std::lround(elapsed / interval) - 1;
+    }
+
+    float rate = getRefreshRate();
+    if (enabled && rate > 0 && std::fabs(rate - refresh_rate_set) > 0.5f) {
+        refresh_rate_set = rate;
+        mpv->setFramePacing(true, rate);
+    }
+
+    vsyncs++;
+    if (!frame_rendered) {
+        return;
+    }
+    frame_rendered = false;
+
+    // a frame should stay on screen floor() or ceil() of refresh/fps vsyncs (3:2 for 24 fps @ 60hz),
+    // anything else is visible as judder
+    double fps = mpv->getFps();
+    if (rate > 0 && fps > 0 && mpv->getSpeed() == 1 && !mpv->isPaused()) {
+        double expected = rate / fps;
+        if (vsyncs < (int) std::floor(expected) || vsyncs > (int) std::ceil(expected)) {
+            judder++;
+        }
+    }
+    vsyncs = 0;
+}
+
+void FramePacer::reset() {
+    // next swap interval would include the load / ui stall
+    swap_time_valid = false;
+    vsyncs = 0;
+    frame_rendered = false;
+    missed = 0;
+    judder = 0;
+}
+
+float FramePacer::getRefreshRate() const {
+    if (samples < PACER_MIN_SAMPLES || interval <= 0) {
+        return 0;
+    }
+    return (float) (1.0 / interval);
+}
+
+unsigned long FramePacer::getMissedVsyncs() const {
+    return missed;
+}
+
+unsigned long FramePacer::getJudder() const {
+    return judder;
+}
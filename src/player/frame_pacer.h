@@ -0,0 +1,57 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_FRAME_PACER_H
+#define PPLAY_FRAME_PACER_H
+
+#include <chrono>
+
+class Mpv;
+
+class FramePacer {
+
+public:
+
+    explicit FramePacer(Mpv *mpv);
+
+    void setEnabled(bool enabled);
+
+    bool isEnabled() const;
+
+    // a new video frame was rendered this frame
+    void onFrameRendered();
+
+    // the renderer flipped (swapped) the previous frame
+    void onSwap();
+
+    void reset();
+
+    // measured display refresh rate (hz), 0 until stable
+    float getRefreshRate() const;
+
+    unsigned long getMissedVsyncs() const;
+
+    unsigned long getJudder() const;
+
+private:
+
+    Mpv *mpv = nullptr;
+    bool enabled = false;
+
+    std::chrono::steady_clock::time_point swap_time;
+    bool swap_time_valid = false;
+    // averaged swap interval (seconds) and samples count
+    double interval = 0;
+    int samples = 0;
+    float refresh_rate_set = 0;
+
+    // vsyncs elapsed since last rendered video frame
+    int vsyncs = 0;
+    bool frame_rendered = false;
+
+    unsigned long missed = 0;
+    unsigned long judder = 0;
+};
+
+#endif //PPLAY_FRAME_PACER_H
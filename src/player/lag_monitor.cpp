@@ -0,0 +1,54 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include "mpv.h"
+#include "lag_monitor.h"
+
+LagMonitor::LagMonitor(Mpv *m) {
+    mpv = m;
+    reset();
+}
+
+void LagMonitor::reset() {
+    sample_time = std::chrono::steady_clock::now();
+    drops = -1;
+    lag_seconds = 0;
+    good_seconds = 0;
+}
+
+bool LagMonitor::update() {
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - sample_time < std::chrono::seconds(1)) {
+        return false;
+    }
+    sample_time = now;
+
+    long count = mpv->getDecoderDropCount() + mpv->getFrameDropCount() + mpv->getDelayedFrameCount();
+    // drops are expected when paused, seeking or playing faster, don't count them
+    bool skip = drops < 0 || count < drops || mpv->isPaused() || mpv->getSpeed() != 1;
+    bool lagging = count > drops;
+    drops = count;
+    if (skip) {
+        return false;
+    }
+
+    if (lagging) {
+        lag_seconds++;
+        good_seconds = 0;
+    } else {
+        good_seconds++;
+        lag_seconds = 0;
+    }
+
+    return true;
+}
+
+int LagMonitor::getLagSeconds() const {
+    return lag_seconds;
+}
+
+int LagMonitor::getGoodSeconds() const {
+    return good_seconds;
+}
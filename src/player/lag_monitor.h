@@ -0,0 +1,38 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_LAG_MONITOR_H
+#define PPLAY_LAG_MONITOR_H
+
+#include <chrono>
+
+class Mpv;
+
+class LagMonitor {
+
+public:
+
+    explicit LagMonitor(Mpv *mpv);
+
+    void reset();
+
+    // sample mpv dropped/delayed frames counters, once per second,
+    // returns true if a new sample was taken
+    bool update();
+
+    // consecutive seconds with (or without) dropped/delayed frames
+    int getLagSeconds() const;
+
+    int getGoodSeconds() const;
+
+private:
+
+    Mpv *mpv = nullptr;
+    std::chrono::steady_clock::time_point sample_time;
+    long drops = -1;
+    int lag_seconds = 0;
+    int good_seconds = 0;
+};
+
+#endif //PPLAY_LAG_MONITOR_H
@@ -3,10 +3,14 @@
 //
 
 #include <sstream>
+#include <ctime>
 #include "main.h"
 #include "player.h"
 #include "player_osd.h"
 #include "video_texture.h"
+#include "frame_pacer.h"
+#include "decode_profile.h"
+#include "cpu_governor.h"
 #include "utility.h"
 
 using namespace c2d;
@@ -26,10 +30,20 @@ Player::Player(Main *_main) : Rectangle(_main->getSize()) {
 
     setVisibility(Visibility::Hidden);
 
-    mpv = new Mpv(main->getIo()->getDataPath() + "mpv", true);
+    // software renderer: cpu only (no gpu needed by mpv), frames are uploaded to the video texture
+    bool software = main->getConfig()->getOption(OPT_VIDEO_RENDERER)->getString() == "Software";
+    mpv = new Mpv(main->getIo()->getDataPath() + "mpv", true, software);
 
-    // TODO: create texture of video size?
-    texture = new VideoTexture(pos, mpv);
+    decodeProfile = new DecodeProfile(mpv);
+
+    governor = new CpuGovernor(mpv);
+    governor->setEnabled(main->getConfig()->getOption(OPT_CPU_BOOST)->getString() == "Auto");
+
+    pacer = new FramePacer(mpv);
+    pacer->setEnabled(main->getConfig()->getOption(OPT_FRAME_PACING)->getString() == "Enabled");
+
+    // render size is adjusted from on screen size and video size, see VideoTexture
+    texture = new VideoTexture(pos, mpv, pacer);
     texture->setOutlineColor(Color::Red);
     texture->setOutlineThickness(4);
     add(texture);
@@ -39,6 +53,9 @@ Player::Player(Main *_main) : Rectangle(_main->getSize()) {
 }
 
 Player::~Player() {
+    delete (pacer);
+    delete (decodeProfile);
+    delete (governor);
     delete (mpv);
 }
 
@@ -52,7 +69,17 @@ bool Player::load(const MediaFile &f) {
     }
 #endif
 
-    int res = mpv->load(path, Mpv::LoadType::Replace, "pause=yes,speed=1");
+    // decoder threads from cached media info (codec, resolution) if any
+    decodeProfile->reset();
+    pacer->reset();
+    std::string options = "pause=yes,speed=1," + decodeProfile->getOptions(file.mediaInfo);
+
+    // async, playback start/errors are handled from mpv events
+    int res = mpv->load(path, Mpv::LoadType::Replace, options, [this](int error) {
+        if (error < 0) {
+            main->getStatus()->show("Error...", "Could not play file:\n" + std::string(mpv_error_string(error)));
+        }
+    });
     if (res != 0) {
         main->getStatus()->show("Error...", "Could not play file:\n" + std::string(mpv_error_string(res)));
         printf("Player::load: could not play file: %s\n", mpv_error_string(res));
@@ -62,6 +89,10 @@ bool Player::load(const MediaFile &f) {
     return true;
 }
 
+void Player::onStartEvent() {
+    main->getStatus()->show("Please Wait...", "Loading... " + file.name, true);
+}
+
 void Player::onLoadEvent() {
 
     // load/update media information (include playback info)
@@ -152,8 +183,22 @@ void Player::onStopEvent(int reason) {
         file.mediaInfo.playbackInfo.position = 0;
     }
 
+    if (reason != MPV_END_FILE_REASON_ERROR) {
+        file.mediaInfo.playbackInfo.last_played = (long) time(nullptr);
+    }
+
     // save mediaInfo (again, for playback position, tracks id..)
     file.mediaInfo.save(file);
+    // "recently played" sort
+    main->getFiler()->setMediaInfo(file, file.mediaInfo);
+
+    const Mpv::EventStats &stats = mpv->getEventStats();
+    printf("Player: mpv events: %lu, overflows: %lu, max depth: %i, max latency: %.2f ms\n",
+           stats.events, stats.overflows, stats.depth_max, stats.latency_max);
+    printf("Player: refresh rate: %.3f hz, missed vsync: %lu, judder: %lu\n",
+           pacer->getRefreshRate(), pacer->getMissedVsyncs(), pacer->getJudder());
+    pacer->reset();
+    texture->printStats();
 
     // audio
     if (menuAudioStreams != nullptr) {
@@ -171,6 +216,7 @@ void Player::onStopEvent(int reason) {
         menuSubtitlesStreams = nullptr;
     }
 
+    governor->reset();
     pplay::Utility::setCpuClock(pplay::Utility::CpuClock::Min);
 #ifdef __SWITCH__
     appletSetMediaPlaybackState(false);
@@ -178,7 +224,7 @@ void Player::onStopEvent(int reason) {
 
     if (main->isExiting()) {
         main->setRunningStop();
-    } else if (mpv->isStopped()) {
+    } else if (mpv->isStopped(true)) {
         setFullscreen(false, true);
     }
 }
@@ -186,82 +232,66 @@ void Player::onStopEvent(int reason) {
 void Player::onUpdate() {
 
     //TODO: cache-buffering-state
-    // handle mpv events
+    // handle all pending mpv events
     if (mpv->isAvailable()) {
-        mpv_event *event = mpv->getEvent();
-        if (event != nullptr) {
-            switch (event->event_id) {
-                case MPV_EVENT_FILE_LOADED:
-                    printf("MPV_EVENT_FILE_LOADED\n");
-                    onLoadEvent();
-                    main->getStatus()->hide();
-                    break;
-                case MPV_EVENT_START_FILE:
-                    printf("MPV_EVENT_START_FILE\n");
-                    main->getStatus()->show("Please Wait...", "Loading... " + file.name, true);
-                    break;
-                case MPV_EVENT_END_FILE:
-                    //auto ef = (mpv_event_end_file *) event->data;
-                    //printf("MPV_EVENT_END_FILE: %i\n", ef->reason);
-                    onStopEvent(((mpv_event_end_file *) event->data)->reason);
-                    break;
-                case MPV_EVENT_SHUTDOWN:
-                    printf("MPV_EVENT_SHUTDOWN\n");
-                    break;
-                case MPV_EVENT_LOG_MESSAGE:
-                    break;
-                case MPV_EVENT_GET_PROPERTY_REPLY:
-                    break;
-                case MPV_EVENT_SET_PROPERTY_REPLY:
-                    break;
-                case MPV_EVENT_COMMAND_REPLY:
-                    break;
-                case MPV_EVENT_TRACKS_CHANGED:
-                    break;
-                case MPV_EVENT_TRACK_SWITCHED:
-                    break;
-                case MPV_EVENT_IDLE:
-                    break;
-                case MPV_EVENT_PAUSE:
-                    break;
-                case MPV_EVENT_UNPAUSE:
-                    break;
-                case MPV_EVENT_TICK:
-                    break;
-                case MPV_EVENT_SCRIPT_INPUT_DISPATCH:
-                    break;
-                case MPV_EVENT_CLIENT_MESSAGE:
-                    break;
-                case MPV_EVENT_VIDEO_RECONFIG:
-                    break;
-                case MPV_EVENT_AUDIO_RECONFIG:
-                    break;
-                case MPV_EVENT_METADATA_UPDATE:
-                    break;
-                case MPV_EVENT_SEEK:
-                    break;
-                case MPV_EVENT_PLAYBACK_RESTART:
-                    printf("MPV_EVENT_PLAYBACK_RESTART\n");
-                    break;
-                case MPV_EVENT_PROPERTY_CHANGE:
-                    break;
-                case MPV_EVENT_CHAPTER_CHANGE:
-                    break;
-                case MPV_EVENT_QUEUE_OVERFLOW:
-                    break;
-                case MPV_EVENT_HOOK:
-                    break;
-                case MPV_EVENT_NONE:
-                    break;
-            }
+        mpv->pollEvents([this](mpv_event *event) {
+            onMpvEvent(event);
+        });
+        if (!mpv->isStopped()) {
+            governor->update();
+            decodeProfile->update();
         }
     }
 
     if (isVisible()) {
+        texture->setScreenScale(getScale().x);
+        texture->setDirect(canRenderDirect());
         Rectangle::onUpdate();
     }
 }
 
+bool Player::canRenderDirect() {
+
+    // video can be rendered straight to the backbuffer only when nothing is drawn over it
+    return fullscreen && getScale().x == 1
+           && !osd->isVisible()
+           && !main->getFiler()->isVisible()
+           && !main->getStatusBar()->isVisible()
+           && !main->getStatus()->isVisible()
+           && !main->getMessageBox()->isVisible()
+           && !main->getMenuMain()->isMenuVisible()
+           && !main->getMenuVideo()->isVisible()
+           && (menuVideoStreams == nullptr || !menuVideoStreams->isVisible())
+           && (menuAudioStreams == nullptr || !menuAudioStreams->isVisible())
+           && (menuSubtitlesStreams == nullptr || !menuSubtitlesStreams->isVisible());
+}
+
+void Player::onMpvEvent(mpv_event *event) {
+
+    switch (event->event_id) {
+        case MPV_EVENT_START_FILE:
+            printf("MPV_EVENT_START_FILE\n");
+            onStartEvent();
+            break;
+        case MPV_EVENT_FILE_LOADED:
+            printf("MPV_EVENT_FILE_LOADED\n");
+            onLoadEvent();
+            main->getStatus()->hide();
+            break;
+        case MPV_EVENT_END_FILE:
+            onStopEvent(((mpv_event_end_file *) event->data)->reason);
+            break;
+        case MPV_EVENT_PLAYBACK_RESTART:
+            printf("MPV_EVENT_PLAYBACK_RESTART\n");
+            break;
+        case MPV_EVENT_SHUTDOWN:
+            printf("MPV_EVENT_SHUTDOWN\n");
+            break;
+        default:
+            break;
+    }
+}
+
 bool Player::onInput(c2d::Input::Player *players) {
 
     unsigned int keys = players[0].keys;
@@ -307,20 +337,26 @@ bool Player::onInput(c2d::Input::Player *players) {
 
 void Player::setVideoStream(int streamId) {
     if (streamId > -1) {
-        mpv->setVid(streamId);
+        mpv->setVid(streamId, [this](int error) {
+            main->getStatus()->hide();
+        });
         file.mediaInfo.playbackInfo.vid_id = streamId;
     }
 }
 
 void Player::setAudioStream(int streamId) {
     if (streamId > -1) {
-        mpv->setAid(streamId);
+        mpv->setAid(streamId, [this](int error) {
+            main->getStatus()->hide();
+        });
         file.mediaInfo.playbackInfo.aud_id = streamId;
     }
 }
 
 void Player::setSubtitleStream(int streamId) {
-    mpv->setSid(streamId);
+    mpv->setSid(streamId, [this](int error) {
+        main->getStatus()->hide();
+    });
     file.mediaInfo.playbackInfo.sub_id = streamId;
 }
 
@@ -341,8 +377,28 @@ void Player::setSpeed(double speed) {
     osd->setVisibility(Visibility::Visible, true);
 }
 
+void Player::setFramePacing(bool enable) {
+    pacer->setEnabled(enable);
+}
+
+void Player::onSwap() {
+    pacer->onSwap();
+}
+
+void Player::setCpuBoost(const std::string &mode) {
+
+    governor->setEnabled(mode == "Auto");
+    governor->reset();
+    if (mode == "Enabled") {
+        pplay::Utility::setCpuClock(pplay::Utility::CpuClock::Max);
+    } else {
+        pplay::Utility::setCpuClock(pplay::Utility::CpuClock::Min);
+    }
+}
+
 void Player::pause() {
     mpv->pause();
+    governor->reset();
     pplay::Utility::setCpuClock(pplay::Utility::CpuClock::Min);
 #ifdef __SWITCH__
     appletSetMediaPlaybackState(false);
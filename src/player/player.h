@@ -15,6 +15,12 @@ class PlayerOSD;
 
 class VideoTexture;
 
+class FramePacer;
+
+class DecodeProfile;
+
+class CpuGovernor;
+
 class Player : public c2d::Rectangle {
 
 public:
@@ -33,6 +39,14 @@ public:
 
     void setSpeed(double speed);
 
+    void setFramePacing(bool enable);
+
+    // "Disabled", "Enabled" or "Auto" (raise clock only when decoding is lagging)
+    void setCpuBoost(const std::string &mode);
+
+    // called once per renderer flip
+    void onSwap();
+
     bool isFullscreen();
 
     void setFullscreen(bool maximize, bool hide = false);
@@ -67,6 +81,12 @@ private:
 
     void onUpdate() override;
 
+    void onMpvEvent(mpv_event *event);
+
+    bool canRenderDirect();
+
+    void onStartEvent();
+
     void onLoadEvent();
 
     void onStopEvent(int reason);
@@ -83,6 +103,9 @@ private:
 
     // player
     VideoTexture *texture = nullptr;
+    FramePacer *pacer = nullptr;
+    DecodeProfile *decodeProfile = nullptr;
+    CpuGovernor *governor = nullptr;
     Mpv *mpv;
 
     bool fullscreen = false;
@@ -143,7 +143,7 @@ void PlayerOSD::onDraw(c2d::Transform &transform, bool draw) {
 
     position = (float) player->getMpv()->getPosition();
     duration = (float) player->getMpv()->getDuration();
-    progress->setProgress(position / duration);
+    progress->setProgress(duration > 0 ? position / duration : 0);
     progress_text->setString(pplay::Utility::formatTime(position));
     duration_text->setString(pplay::Utility::formatTime(duration));
 
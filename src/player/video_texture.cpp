@@ -2,23 +2,97 @@
 // Created by cpasjuste on 09/12/18.
 //
 
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 #include "cross2d/c2d.h"
 #include "video_texture.h"
 
+#define RENDER_SCALE_MIN    0.1f
+#define RENDER_QUALITY_MIN  0.5f
+#define SW_ALIGN            64
+
 using namespace c2d;
 
-VideoTexture::VideoTexture(const c2d::Vector2f &size, Mpv *m) : GLTextureBuffer(size, Format::RGBA8) {
+// mpv "rgb0" to gl rgba: same byte order, only need to set the padding byte to 255.
+// rows are written bottom-up, to match the opengl fbo (flip_y = 0) layout.
+static void rgb0_to_rgba(const uint8_t *src, size_t stride, uint8_t *dst, int w, int h) {
+
+    for (int y = 0; y < h; y++) {
+        const auto *s = (const uint32_t *) (src + y * stride);
+        auto *d = (uint32_t *) (dst + (size_t) (h - 1 - y) * w * 4);
+        int x = 0;
+#if defined(__SSE2__)
+        const __m128i alpha = _mm_set1_epi32((int) 0xFF000000);
+        for (; x + 16 <= w; x += 16) {
+            __m128i p0 = _mm_load_si128((const __m128i *) (s + x));
+            __m128i p1 = _mm_load_si128((const __m128i *) (s + x + 4));
+            __m128i p2 = _mm_load_si128((const __m128i *) (s + x + 8));
+            __m128i p3 = _mm_load_si128((const __m128i *) (s + x + 12));
+            _mm_storeu_si128((__m128i *) (d + x), _mm_or_si128(p0, alpha));
+            _mm_storeu_si128((__m128i *) (d + x + 4), _mm_or_si128(p1, alpha));
+            _mm_storeu_si128((__m128i *) (d + x + 8), _mm_or_si128(p2, alpha));
+            _mm_storeu_si128((__m128i *) (d + x + 12), _mm_or_si128(p3, alpha));
+        }
+#elif defined(__ARM_NEON)
+        const uint32x4_t alpha = vdupq_n_u32(0xFF000000);
+        for (; x + 16 <= w; x += 16) {
+            uint32x4_t p0 = vld1q_u32(s + x);
+            uint32x4_t p1 = vld1q_u32(s + x + 4);
+            uint32x4_t p2 = vld1q_u32(s + x + 8);
+            uint32x4_t p3 = vld1q_u32(s + x + 12);
+            vst1q_u32(d + x, vorrq_u32(p0, alpha));
+            vst1q_u32(d + x + 4, vorrq_u32(p1, alpha));
+            vst1q_u32(d + x + 8, vorrq_u32(p2, alpha));
+            vst1q_u32(d + x + 12, vorrq_u32(p3, alpha));
+        }
+#endif
+        for (; x < w; x++) {
+            // little endian: padding byte is the high byte
+            d[x] = s[x] | 0xFF000000u;
+        }
+    }
+}
+
+VideoTexture::VideoTexture(const c2d::Vector2f &size, Mpv *m, FramePacer *p)
+        : GLTextureBuffer(size, Format::RGBA8) {
 
     mpv = m;
+    pacer = p;
+    textureSize = size;
 
     // fade
     fade = new C2DTexture(c2d_renderer->getIo()->getRomFsPath() + "skin/fade.png");
-    fade->setScale(size.x / fade->getTextureRect().width, size.y / fade->getTextureRect().height);
+    fadeScale = {size.x / fade->getTextureRect().width, size.y / fade->getTextureRect().height};
+    fade->setScale(fadeScale);
     fade->setFillColor(Color::Black);
     fade->setAlpha(0);
     fadeTween = new TweenAlpha(0, 255, 0.5f);
     fade->add(fadeTween);
     add(fade);
+
+    if (mpv->isSoftware()) {
+        // mpv output buffer, rows aligned for simd loads
+        swStride = ((size_t) textureSize.x * 4 + SW_ALIGN - 1) & ~((size_t) SW_ALIGN - 1);
+        size_t size = swStride * (size_t) textureSize.y;
+        swRaw = (uint8_t *) malloc(size + SW_ALIGN);
+        swBuffer = (uint8_t *) (((uintptr_t) swRaw + SW_ALIGN - 1) & ~((uintptr_t) SW_ALIGN - 1));
+        swPixels = (uint8_t *) malloc((size_t) textureSize.x * (size_t) textureSize.y * 4);
+    }
+}
+
+VideoTexture::~VideoTexture() {
+    if (swRaw) {
+        free(swRaw);
+    }
+    if (swPixels) {
+        free(swPixels);
+    }
 }
 
 void VideoTexture::hideFade() {
@@ -29,25 +103,206 @@ void VideoTexture::showFade() {
     fadeTween->play(TweenDirection::Forward);
 }
 
+void VideoTexture::setScreenScale(float scale) {
+    screenScale = scale;
+}
+
+void VideoTexture::setDirect(bool d) {
+    // software frames need to be uploaded to the texture anyway
+    d = d && !mpv->isSoftware();
+    if (direct && !d) {
+        fboDirty = true;
+    }
+    direct = d;
+}
+
+void VideoTexture::printStats() {
+
+    printf("VideoTexture: fbo frames: %lu (%.2f ms), direct frames: %lu (%.2f ms), saved: %.1f MB\n",
+           framesFbo, drawTimeFbo, framesDirect, drawTimeDirect, bytesSaved / (1024 * 1024));
+
+    framesDirect = framesFbo = 0;
+    drawTimeDirect = drawTimeFbo = 0;
+    bytesSaved = 0;
+}
+
+float VideoTexture::getRenderScale() {
+
+    float scale = screenScale * quality;
+
+    // no need to render more pixels than the video have
+    int width = mpv->getVideoWidth();
+    int height = mpv->getVideoHeight();
+    if (width > 0 && height > 0) {
+        scale = std::min(scale, std::max((float) width / textureSize.x, (float) height / textureSize.y));
+    }
+
+    // 1/20 steps, avoid changing fbo size on every tween frame
+    scale = std::ceil(scale * 20) / 20;
+
+    return std::max(RENDER_SCALE_MIN, std::min(scale, 1.0f));
+}
+
+void VideoTexture::setRenderScale(float scale) {
+
+    renderScale = scale;
+
+    // only draw the rendered part of the fbo, scaled back to full size
+    IntRect rect = {0, 0, (int) (textureSize.x * scale), (int) (textureSize.y * scale)};
+    setTextureRect(rect);
+    setScale(textureSize.x / (float) rect.width, textureSize.y / (float) rect.height);
+    // fade is a child, compensate
+    fade->setScale(fadeScale.x / getScale().x, fadeScale.y / getScale().y);
+}
+
+void VideoTexture::updateQuality(float time) {
+
+    // frame budget from measured refresh rate, half of it for video rendering
+    float rate = pacer->getRefreshRate();
+    float budget = (1000.0f / (rate > 0 ? rate : 60.0f)) / 2;
+
+    renderTime = renderTime == 0 ? time : renderTime + (time - renderTime) * 0.1f;
+
+    if (renderTime > budget) {
+        renderFast = 0;
+        if (++renderSlow >= 30 && quality > RENDER_QUALITY_MIN) {
+            quality = std::max(RENDER_QUALITY_MIN, quality * 0.8f);
+            renderSlow = 0;
+            printf("VideoTexture: render time %.2f ms > %.2f ms, quality: %.2f\n", renderTime, budget, quality);
+        }
+    } else if (renderTime < budget / 2) {
+        renderSlow = 0;
+        if (++renderFast >= 120 && quality < 1) {
+            quality = std::min(1.0f, quality * 1.25f);
+            renderFast = 0;
+        }
+    }
+}
+
+void VideoTexture::renderFbo(int w, int h) {
+
+    int flip_y{0};
+    // when pacing, mpv times frames from reported swaps instead of blocking the ui thread
+    int block_for_target{pacer->isEnabled() ? 0 : 1};
+    mpv_opengl_fbo mpv_fbo{
+            .fbo = fbo,
+            .w = w, .h = h,
+            .internal_format = GL_RGBA8};
+    mpv_render_param r_params[] = {
+            {MPV_RENDER_PARAM_OPENGL_FBO,             &mpv_fbo},
+            {MPV_RENDER_PARAM_FLIP_Y,                 &flip_y},
+            {MPV_RENDER_PARAM_BLOCK_FOR_TARGET_TIME, &block_for_target},
+            {MPV_RENDER_PARAM_INVALID,                nullptr}
+    };
+
+    GLint vp[4];
+    glGetIntegerv(GL_VIEWPORT, vp);
+    mpv_render_context_render(mpv->getContext(), r_params);
+    glViewport(vp[0], vp[1], (GLsizei) vp[2], (GLsizei) vp[3]);
+}
+
+void VideoTexture::renderSoftware(int w, int h) {
+
+    int size[2] = {w, h};
+    size_t stride = swStride;
+    int block_for_target{pacer->isEnabled() ? 0 : 1};
+    mpv_render_param r_params[] = {
+            {MPV_RENDER_PARAM_SW_SIZE,                size},
+            {MPV_RENDER_PARAM_SW_FORMAT,              (void *) "rgb0"},
+            {MPV_RENDER_PARAM_SW_STRIDE,              &stride},
+            {MPV_RENDER_PARAM_SW_POINTER,             swBuffer},
+            {MPV_RENDER_PARAM_BLOCK_FOR_TARGET_TIME, &block_for_target},
+            {MPV_RENDER_PARAM_INVALID,                nullptr}
+    };
+
+    if (mpv_render_context_render(mpv->getContext(), r_params) < 0) {
+        return;
+    }
+
+    // strided rgb0 to packed rgba in one pass, then upload the rendered part only
+    rgb0_to_rgba(swBuffer, swStride, swPixels, w, h);
+    glBindTexture(GL_TEXTURE_2D, texID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, swPixels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void VideoTexture::renderDirect() {
+
+    // render into whatever the renderer is drawing to, backbuffer content
+    // isn't preserved between flips so we need to render every frame
+    GLint fb = 0;
+    GLint vp[4];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &fb);
+    glGetIntegerv(GL_VIEWPORT, vp);
+
+    // rendered anyway (backbuffer), but only a new frame counts for pacing
+    bool newFrame = mpv->hasNewFrame();
+    int flip_y{fb == 0 ? 1 : 0};
+    int block_for_target{pacer->isEnabled() ? 0 : 1};
+    mpv_opengl_fbo mpv_fbo{
+            .fbo = fb,
+            .w = (int) vp[2], .h = (int) vp[3],
+            .internal_format = 0};
+    mpv_render_param r_params[] = {
+            {MPV_RENDER_PARAM_OPENGL_FBO,             &mpv_fbo},
+            {MPV_RENDER_PARAM_FLIP_Y,                 &flip_y},
+            {MPV_RENDER_PARAM_BLOCK_FOR_TARGET_TIME, &block_for_target},
+            {MPV_RENDER_PARAM_INVALID,                nullptr}
+    };
+
+    mpv_render_context_render(mpv->getContext(), r_params);
+    glViewport(vp[0], vp[1], (GLsizei) vp[2], (GLsizei) vp[3]);
+    if (newFrame) {
+        pacer->onFrameRendered();
+    }
+
+    // fbo write + fbo read (textured quad) we didn't do
+    bytesSaved += (double) vp[2] * vp[3] * 4 * 2;
+}
+
 void VideoTexture::onDraw(c2d::Transform &transform, bool draw) {
 
+    auto drawStart = std::chrono::steady_clock::now();
+
+    // the fade overlay (child) is only drawn on top of the fbo texture
+    if (draw && direct && fade->getAlpha() == 0 && mpv && mpv->isAvailable()) {
+        renderDirect();
+        fboDirty = true;
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - drawStart;
+        drawTimeDirect += (elapsed.count() - drawTimeDirect) / (float) ++framesDirect;
+        return;
+    }
+
     if (draw && mpv && mpv->isAvailable()) {
-        int flip_y{0};
-        mpv_opengl_fbo mpv_fbo{
-                .fbo = fbo,
-                .w = (int) getSize().x, .h = (int) getSize().y,
-                .internal_format = GL_RGBA8};
-        mpv_render_param r_params[] = {
-                {MPV_RENDER_PARAM_OPENGL_FBO, &mpv_fbo},
-                {MPV_RENDER_PARAM_FLIP_Y,     &flip_y},
-                {MPV_RENDER_PARAM_INVALID,    nullptr}
-        };
-
-        GLint vp[4];
-        glGetIntegerv(GL_VIEWPORT, vp);
-        mpv_render_context_render(mpv->getContext(), r_params);
-        glViewport(vp[0], vp[1], (GLsizei) vp[2], (GLsizei) vp[3]);
+
+        float scale = getRenderScale();
+        bool resized = scale != renderScale;
+        if (resized) {
+            setRenderScale(scale);
+        }
+
+        // only render when mpv has a new frame (or size changed), else reuse the fbo content
+        if (mpv->hasNewFrame() || resized || fboDirty) {
+            fboDirty = false;
+            int w = (int) (textureSize.x * renderScale);
+            int h = (int) (textureSize.y * renderScale);
+            auto start = std::chrono::steady_clock::now();
+            if (mpv->isSoftware()) {
+                renderSoftware(w, h);
+            } else {
+                renderFbo(w, h);
+            }
+            std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            pacer->onFrameRendered();
+            updateQuality(elapsed.count());
+        }
     }
 
     GLTextureBuffer::onDraw(transform, draw);
+
+    if (draw) {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - drawStart;
+        drawTimeFbo += (elapsed.count() - drawTimeFbo) / (float) ++framesFbo;
+    }
 }
@@ -6,25 +6,76 @@
 #define PPLAY_VIDEO_TEXTURE_H
 
 #include "player.h"
+#include "frame_pacer.h"
 #include "gradient_rectangle.h"
 
 class VideoTexture : public c2d::GLTextureBuffer {
 
 public:
 
-    explicit VideoTexture(const c2d::Vector2f &size, Mpv *mpv);
+    explicit VideoTexture(const c2d::Vector2f &size, Mpv *mpv, FramePacer *pacer);
+
+    ~VideoTexture() override;
 
     void showFade();
 
     void hideFade();
 
+    // on screen scale of the texture (player minimized..)
+    void setScreenScale(float scale);
+
+    // render straight into the renderer framebuffer, only when nothing is drawn over the video
+    void setDirect(bool direct);
+
+    void printStats();
+
 private:
 
     void onDraw(c2d::Transform &transform, bool draw = true) override;
 
+    float getRenderScale();
+
+    void setRenderScale(float scale);
+
+    void updateQuality(float renderTime);
+
+    void renderFbo(int w, int h);
+
+    void renderSoftware(int w, int h);
+
+    void renderDirect();
+
     Mpv *mpv = nullptr;
+    FramePacer *pacer = nullptr;
     c2d::Texture *fade = nullptr;
     c2d::TweenAlpha *fadeTween = nullptr;
+    c2d::Vector2f fadeScale;
+
+    // mpv renders in a (w * scale, h * scale) part of the fbo
+    c2d::Vector2f textureSize;
+    float renderScale = 1;
+    float screenScale = 1;
+    // lowered when render time exceeds the frame budget
+    float quality = 1;
+    float renderTime = 0;
+    int renderSlow = 0;
+    int renderFast = 0;
+
+    // fbo content is outdated after direct rendering
+    bool direct = false;
+    bool fboDirty = false;
+    // frames drawn in each mode, with average video draw time (ms)
+    unsigned long framesDirect = 0;
+    unsigned long framesFbo = 0;
+    float drawTimeDirect = 0;
+    float drawTimeFbo = 0;
+    double bytesSaved = 0;
+
+    // software rendering: mpv output (aligned rows) and packed rgba upload buffer
+    uint8_t *swRaw = nullptr;
+    uint8_t *swBuffer = nullptr;
+    uint8_t *swPixels = nullptr;
+    size_t swStride = 0;
 };
 
 #endif //PPLAY_VIDEO_TEXTURE_H
@@ -18,8 +18,11 @@ PPLAYConfig::PPLAYConfig(Main *main, int version)
     addOption({OPT_LAST_PATH, main->getIo()->getDataPath()});
     addOption({OPT_CACHE_MEDIA_INFO, (int) 1});
     //addOption({OPT_BUFFER, "Low"}); // Low, Medium, High, VeryHigh
-    addOption({OPT_CPU_BOOST, "Disabled"}); // Disabled, Enabled
+    addOption({OPT_CPU_BOOST, "Auto"}); // Disabled, Enabled, Auto
+    addOption({OPT_FRAME_PACING, "Disabled"}); // Disabled, Enabled
+    addOption({OPT_VIDEO_RENDERER, "OpenGL"}); // OpenGL, Software (needs restart)
     addOption({OPT_TMDB_LANGUAGE, "en-US"});
+    addOption({OPT_SORT_MODE, "Title"}); // Title, Name, Size, Duration, Resolution, Played
 
     // load the configuration from file, overwriting default values
     load();
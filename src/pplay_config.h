@@ -14,7 +14,10 @@
 #define OPT_CACHE_MEDIA_INFO    "CACHE_MEDIA_INFO"
 //#define OPT_BUFFER              "BUFFER"
 #define OPT_CPU_BOOST           "CPU_BOOST"
+#define OPT_FRAME_PACING        "FRAME_PACING"
+#define OPT_VIDEO_RENDERER      "VIDEO_RENDERER"
 #define OPT_TMDB_LANGUAGE       "TMDB_LANGUAGE"
+#define OPT_SORT_MODE           "SORT_MODE"
 
 class Main;
 
@@ -0,0 +1,200 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include <cstring>
+#include <algorithm>
+#include <curl/curl.h>
+
+#include "cross2d/c2d.h"
+#include "byte_source.h"
+#include "http_pool.h"
+
+// local reads are cheap, http reads cost a round trip
+#define FILE_BLOCK_SIZE (64 * 1024)
+#define HTTP_BLOCK_SIZE (256 * 1024)
+
+using namespace pplay;
+
+ByteSource::ByteSource(size_t bs) {
+    blockSize = bs;
+}
+
+bool ByteSource::read(int64_t offset, void *buffer, size_t length) {
+
+    if (offset < 0 || (size > 0 && offset + (int64_t) length > size)) {
+        return false;
+    }
+
+    if (offset < blockOffset || offset + (int64_t) length > blockOffset + (int64_t) block.size()) {
+        size_t len = std::max(length, blockSize);
+        if (size > 0) {
+            len = (size_t) std::min((int64_t) len, size - offset);
+        }
+        block.clear();
+        blockOffset = offset;
+        requests++;
+        if (!fetch(offset, len, &block)) {
+            block.clear();
+            return false;
+        }
+        bytesRead += (int64_t) block.size();
+        if (block.size() < length) {
+            return false;
+        }
+    }
+
+    memcpy(buffer, block.data() + (offset - blockOffset), length);
+
+    return true;
+}
+
+ByteSource *ByteSource::create(const std::string &path) {
+
+    if (c2d::Utility::startWith(path, "http://") || c2d::Utility::startWith(path, "https://")) {
+        auto source = new HttpSource(path);
+        if (!source->isOpen()) {
+            delete (source);
+            return nullptr;
+        }
+        return source;
+    }
+
+    if (c2d::Utility::startWith(path, "ftp://")) {
+        return nullptr;
+    }
+
+    auto source = new FileSource(path);
+    if (!source->isOpen()) {
+        delete (source);
+        return nullptr;
+    }
+    return source;
+}
+
+FileSource::FileSource(const std::string &path) : ByteSource(FILE_BLOCK_SIZE) {
+
+    fp = fopen(path.c_str(), "rb");
+    if (fp) {
+        fseeko(fp, 0, SEEK_END);
+        size = (int64_t) ftello(fp);
+    }
+}
+
+bool FileSource::fetch(int64_t offset, size_t length, std::vector<uint8_t> *data) {
+
+    if (fseeko(fp, (off_t) offset, SEEK_SET) != 0) {
+        return false;
+    }
+
+    data->resize(length);
+    size_t len = fread(data->data(), 1, length, fp);
+    data->resize(len);
+
+    return len > 0;
+}
+
+FileSource::~FileSource() {
+    if (fp) {
+        fclose(fp);
+    }
+}
+
+// escape file name characters (spaces..), keep url structure
+static std::string escape_url(CURL *curl, const std::string &url) {
+
+    size_t start = url.find("://");
+    start = url.find('/', start == std::string::npos ? 0 : start + 3);
+    if (start == std::string::npos) {
+        return url;
+    }
+
+    std::string escaped = url.substr(0, start);
+    size_t pos = start;
+    while (pos < url.size()) {
+        size_t next = url.find('/', pos + 1);
+        std::string part = url.substr(pos + 1, next == std::string::npos ? std::string::npos : next - pos - 1);
+        char *e = curl_easy_escape(curl, part.c_str(), (int) part.size());
+        escaped += "/" + std::string(e ? e : part.c_str());
+        curl_free(e);
+        pos = next;
+    }
+
+    return escaped;
+}
+
+class HttpWrite {
+public:
+    std::vector<uint8_t> *data;
+    size_t max;
+};
+
+size_t HttpSource::onWrite(void *ptr, size_t size, size_t count, void *userdata) {
+
+    auto write = (HttpWrite *) userdata;
+    size_t len = size * count;
+    size_t left = write->max - write->data->size();
+    if (len > left) {
+        // server sent more than asked (range ignored), stop the transfer
+        write->data->insert(write->data->end(), (uint8_t *) ptr, (uint8_t *) ptr + left);
+        return 0;
+    }
+
+    write->data->insert(write->data->end(), (uint8_t *) ptr, (uint8_t *) ptr + len);
+    return len;
+}
+
+HttpSource::HttpSource(const std::string &u) : ByteSource(HTTP_BLOCK_SIZE) {
+
+    // pooled handle, probes of files on the same host reuse its connection
+    curl = HttpPool::getInstance()->acquire();
+    if (!curl) {
+        return;
+    }
+
+    url = escape_url(curl, u);
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+
+    // content length
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    requests++;
+    if (HttpPool::getInstance()->perform(curl) == CURLE_OK) {
+        long code = 0;
+        curl_off_t length = -1;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+        curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+        if (code == 200 && length > 0) {
+            size = (int64_t) length;
+        }
+    }
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 0L);
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+}
+
+bool HttpSource::fetch(int64_t offset, size_t length, std::vector<uint8_t> *data) {
+
+    HttpWrite write{data, length};
+    std::string range = std::to_string(offset) + "-" + std::to_string(offset + (int64_t) length - 1);
+
+    curl_easy_setopt(curl, CURLOPT_RANGE, range.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, onWrite);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &write);
+    CURLcode res = HttpPool::getInstance()->perform(curl);
+
+    long code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+    if (code != 206 && !(code == 200 && offset == 0)) {
+        // no range support
+        return false;
+    }
+
+    return (res == CURLE_OK || data->size() == length) && !data->empty();
+}
+
+HttpSource::~HttpSource() {
+    HttpPool::getInstance()->release(curl);
+}
@@ -0,0 +1,90 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_BYTE_SOURCE_H
+#define PPLAY_BYTE_SOURCE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace pplay {
+
+    // random access reader used by the container parser, reads are
+    // served from a block cache so small header reads don't hit the device
+    class ByteSource {
+
+    public:
+
+        explicit ByteSource(size_t blockSize);
+
+        virtual ~ByteSource() = default;
+
+        // -1 if unknown
+        int64_t getSize() const { return size; };
+
+        bool read(int64_t offset, void *buffer, size_t length);
+
+        // device reads done (http: range requests)
+        int getRequests() const { return requests; };
+
+        int64_t getBytesRead() const { return bytesRead; };
+
+        static ByteSource *create(const std::string &path);
+
+    protected:
+
+        virtual bool fetch(int64_t offset, size_t length, std::vector<uint8_t> *data) = 0;
+
+        int64_t size = -1;
+        int requests = 0;
+        int64_t bytesRead = 0;
+
+    private:
+
+        size_t blockSize;
+        int64_t blockOffset = 0;
+        std::vector<uint8_t> block;
+    };
+
+    class FileSource : public ByteSource {
+
+    public:
+
+        explicit FileSource(const std::string &path);
+
+        ~FileSource() override;
+
+        bool isOpen() const { return fp != nullptr; };
+
+    private:
+
+        bool fetch(int64_t offset, size_t length, std::vector<uint8_t> *data) override;
+
+        FILE *fp = nullptr;
+    };
+
+    class HttpSource : public ByteSource {
+
+    public:
+
+        explicit HttpSource(const std::string &url);
+
+        ~HttpSource() override;
+
+        bool isOpen() const { return size > 0; };
+
+    private:
+
+        bool fetch(int64_t offset, size_t length, std::vector<uint8_t> *data) override;
+
+        static size_t onWrite(void *ptr, size_t size, size_t count, void *userdata);
+
+        void *curl = nullptr;
+        std::string url;
+    };
+}
+
+#endif //PPLAY_BYTE_SOURCE_H
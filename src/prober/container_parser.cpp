@@ -0,0 +1,1087 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include <cstring>
+#include <cmath>
+#include <functional>
+
+#include "cross2d/c2d.h"
+#include "byte_source.h"
+#include "container_parser.h"
+
+// max header sizes we are willing to read
+#define MP4_MOOV_MAX    (32 * 1024 * 1024)
+#define AVI_HDRL_MAX    (4 * 1024 * 1024)
+#define TS_SCAN_SIZE    (2 * 1024 * 1024)
+#define TS_TAIL_SIZE    (1024 * 1024)
+
+#define EBML_UNKNOWN    UINT64_MAX
+
+using namespace pplay;
+
+static uint16_t be16(const uint8_t *p) {
+    return (uint16_t) ((p[0] << 8) | p[1]);
+}
+
+static uint32_t be32(const uint8_t *p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static uint64_t be64(const uint8_t *p) {
+    return ((uint64_t) be32(p) << 32) | be32(p + 4);
+}
+
+static uint16_t le16(const uint8_t *p) {
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t *p) {
+    return p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint32_t fourcc(const char *s) {
+    return be32((const uint8_t *) s);
+}
+
+static std::string fourcc_string(uint32_t f) {
+    std::string s;
+    for (int i = 3; i >= 0; i--) {
+        char c = (char) ((f >> (i * 8)) & 0xFF);
+        if (c >= 'A' && c <= 'Z') {
+            c = (char) (c - 'A' + 'a');
+        }
+        if (c != ' ' && c != '\0') {
+            s += c;
+        }
+    }
+    return s;
+}
+
+// mpv numbers tracks per type, starting at 1
+static void add_track(MediaInfo *mediaInfo, MediaInfo::Track track) {
+
+    std::vector<MediaInfo::Track> *tracks = &mediaInfo->subtitles;
+    if (track.type == "video") {
+        tracks = &mediaInfo->videos;
+    } else if (track.type == "audio") {
+        tracks = &mediaInfo->audios;
+    }
+
+    track.id = (int) tracks->size() + 1;
+    tracks->push_back(track);
+}
+
+static bool set_language(MediaInfo::Track *track, const std::string &lang) {
+    if (!lang.empty() && lang != "und") {
+        track->language = lang;
+        return true;
+    }
+    return false;
+}
+
+//
+// matroska / webm
+//
+
+class EbmlElement {
+public:
+    uint32_t id = 0;
+    int64_t data = 0;
+    uint64_t size = 0;
+
+    int64_t end(int64_t limit) const {
+        return size == EBML_UNKNOWN ? limit : std::min(limit, data + (int64_t) size);
+    }
+};
+
+static bool ebml_vint(ByteSource *source, int64_t pos, uint64_t *value, int *length, bool id) {
+
+    uint8_t b[8];
+    if (!source->read(pos, b, 1)) {
+        return false;
+    }
+
+    int len = 1;
+    uint8_t mask = 0x80;
+    while (len <= 8 && !(b[0] & mask)) {
+        mask >>= 1;
+        len++;
+    }
+    if (len > 8 || (len > 1 && !source->read(pos + 1, b + 1, (size_t) len - 1))) {
+        return false;
+    }
+
+    uint64_t v = id ? b[0] : (b[0] & (mask - 1));
+    bool unknown = (b[0] & (mask - 1)) == (mask - 1);
+    for (int i = 1; i < len; i++) {
+        v = (v << 8) | b[i];
+        unknown &= b[i] == 0xFF;
+    }
+
+    *value = !id && unknown ? EBML_UNKNOWN : v;
+    *length = len;
+
+    return true;
+}
+
+static bool ebml_element(ByteSource *source, int64_t pos, EbmlElement *element) {
+
+    uint64_t id, size;
+    int idLen, sizeLen;
+
+    if (!ebml_vint(source, pos, &id, &idLen, true)
+        || !ebml_vint(source, pos + idLen, &size, &sizeLen, false)) {
+        return false;
+    }
+
+    element->id = (uint32_t) id;
+    element->size = size;
+    element->data = pos + idLen + sizeLen;
+
+    return true;
+}
+
+static uint64_t ebml_uint(ByteSource *source, const EbmlElement &element) {
+
+    uint8_t b[8];
+    if (element.size == 0 || element.size > 8 || !source->read(element.data, b, (size_t) element.size)) {
+        return 0;
+    }
+
+    uint64_t v = 0;
+    for (uint64_t i = 0; i < element.size; i++) {
+        v = (v << 8) | b[i];
+    }
+    return v;
+}
+
+static double ebml_float(ByteSource *source, const EbmlElement &element) {
+
+    uint8_t b[8];
+    if (element.size == 4 && source->read(element.data, b, 4)) {
+        uint32_t i = be32(b);
+        float f;
+        memcpy(&f, &i, 4);
+        return f;
+    } else if (element.size == 8 && source->read(element.data, b, 8)) {
+        uint64_t i = be64(b);
+        double d;
+        memcpy(&d, &i, 8);
+        return d;
+    }
+
+    return 0;
+}
+
+static std::string ebml_string(ByteSource *source, const EbmlElement &element) {
+
+    if (element.size == 0 || element.size > 1024) {
+        return "";
+    }
+
+    std::string s((size_t) element.size, '\0');
+    if (!source->read(element.data, &s[0], (size_t) element.size)) {
+        return "";
+    }
+    s.resize(strlen(s.c_str()));
+    return s;
+}
+
+static bool ebml_children(ByteSource *source, const EbmlElement &parent, int64_t limit,
+                          const std::function<bool(const EbmlElement &)> &callback) {
+
+    int64_t pos = parent.data;
+    int64_t end = parent.end(limit);
+
+    while (pos < end) {
+        EbmlElement element;
+        if (!ebml_element(source, pos, &element)) {
+            return false;
+        }
+        if (!callback(element) || element.size == EBML_UNKNOWN) {
+            break;
+        }
+        pos = element.data + (int64_t) element.size;
+    }
+
+    return true;
+}
+
+static std::string mkv_codec(const std::string &id) {
+
+    static const char *codecs[][2] = {
+            {"V_MPEG4/ISO/AVC",   "h264"},
+            {"V_MPEGH/ISO/HEVC",  "hevc"},
+            {"V_MPEG4/ISO/ASP",   "mpeg4"},
+            {"V_MPEG4/ISO/SP",    "mpeg4"},
+            {"V_MPEG4/MS/V3",     "msmpeg4v3"},
+            {"V_MPEG2",           "mpeg2video"},
+            {"V_MPEG1",           "mpeg1video"},
+            {"V_VP8",             "vp8"},
+            {"V_VP9",             "vp9"},
+            {"V_AV1",             "av1"},
+            {"V_THEORA",          "theora"},
+            {"V_MJPEG",           "mjpeg"},
+            {"A_AAC",             "aac"},
+            {"A_AC3",             "ac3"},
+            {"A_EAC3",            "eac3"},
+            {"A_DTS",             "dts"},
+            {"A_TRUEHD",          "truehd"},
+            {"A_OPUS",            "opus"},
+            {"A_VORBIS",          "vorbis"},
+            {"A_FLAC",            "flac"},
+            {"A_MPEG/L3",         "mp3"},
+            {"A_MPEG/L2",         "mp2"},
+            {"A_PCM/INT/LIT",     "pcm_s16le"},
+            {"A_PCM/INT/BIG",     "pcm_s16be"},
+            {"A_PCM/FLOAT/IEEE",  "pcm_f32le"},
+            {"S_TEXT/UTF8",       "subrip"},
+            {"S_TEXT/ASCII",      "subrip"},
+            {"S_TEXT/ASS",        "ass"},
+            {"S_TEXT/SSA",        "ass"},
+            {"S_ASS",             "ass"},
+            {"S_SSA",             "ass"},
+            {"S_TEXT/WEBVTT",     "webvtt"},
+            {"S_HDMV/PGS",        "hdmv_pgs_subtitle"},
+            {"S_HDMV/TEXTST",     "hdmv_text_subtitle"},
+            {"S_VOBSUB",          "dvd_subtitle"},
+            {"S_DVBSUB",          "dvb_subtitle"},
+    };
+
+    // prefix match (A_AAC/MPEG4/LC, A_DTS/EXPRESS..)
+    for (auto &codec : codecs) {
+        if (id.compare(0, strlen(codec[0]), codec[0]) == 0) {
+            return codec[1];
+        }
+    }
+
+    return c2d::Utility::toLower(id.size() > 2 ? id.substr(2) : id);
+}
+
+static void mkv_track(ByteSource *source, const EbmlElement &entry, int64_t limit, MediaInfo *mediaInfo) {
+
+    MediaInfo::Track track{};
+    track.title = "Unknown";
+    track.language = "N/A";
+    uint64_t type = 0;
+    bool ietf = false;
+
+    ebml_children(source, entry, limit, [&](const EbmlElement &e) {
+        switch (e.id) {
+            case 0x83: // TrackType
+                type = ebml_uint(source, e);
+                break;
+            case 0x86: // CodecID
+                track.codec = mkv_codec(ebml_string(source, e));
+                break;
+            case 0x536E: // Name
+                track.title = ebml_string(source, e);
+                break;
+            case 0x22B59C: // Language
+                if (!ietf) {
+                    set_language(&track, ebml_string(source, e));
+                }
+                break;
+            case 0x22B59D: // LanguageIETF
+                ietf = set_language(&track, ebml_string(source, e));
+                break;
+            case 0xE0: // Video
+                ebml_children(source, e, limit, [&](const EbmlElement &v) {
+                    if (v.id == 0xB0) {
+                        track.width = (int) ebml_uint(source, v);
+                    } else if (v.id == 0xBA) {
+                        track.height = (int) ebml_uint(source, v);
+                    }
+                    return true;
+                });
+                break;
+            case 0xE1: // Audio
+                ebml_children(source, e, limit, [&](const EbmlElement &a) {
+                    if (a.id == 0xB5) {
+                        track.sample_rate = (int) ebml_float(source, a);
+                    } else if (a.id == 0x9F) {
+                        track.channels = (int) ebml_uint(source, a);
+                    }
+                    return true;
+                });
+                break;
+            default:
+                break;
+        }
+        return true;
+    });
+
+    if (type == 1) {
+        track.type = "video";
+    } else if (type == 2) {
+        track.type = "audio";
+    } else if (type == 0x11) {
+        track.type = "sub";
+    } else {
+        return;
+    }
+
+    add_track(mediaInfo, track);
+}
+
+static bool parse_mkv(ByteSource *source, MediaInfo *mediaInfo) {
+
+    int64_t limit = source->getSize();
+    EbmlElement element;
+
+    if (!ebml_element(source, 0, &element) || element.id != 0x1A45DFA3 || element.size == EBML_UNKNOWN) {
+        return false;
+    }
+
+    EbmlElement segment;
+    if (!ebml_element(source, element.data + (int64_t) element.size, &segment) || segment.id != 0x18538067) {
+        return false;
+    }
+
+    MediaInfo info;
+    bool hasInfo = false, hasTracks = false;
+    int64_t infoPos = -1, tracksPos = -1;
+    uint64_t timecodeScale = 1000000;
+    double duration = 0;
+
+    auto parseInfo = [&](const EbmlElement &e) {
+        hasInfo = true;
+        ebml_children(source, e, limit, [&](const EbmlElement &i) {
+            if (i.id == 0x2AD7B1) {
+                timecodeScale = ebml_uint(source, i);
+            } else if (i.id == 0x4489) {
+                duration = ebml_float(source, i);
+            }
+            return true;
+        });
+    };
+
+    auto parseTracks = [&](const EbmlElement &e) {
+        hasTracks = true;
+        ebml_children(source, e, limit, [&](const EbmlElement &t) {
+            if (t.id == 0xAE) {
+                mkv_track(source, t, limit, &info);
+            }
+            return true;
+        });
+    };
+
+    ebml_children(source, segment, limit, [&](const EbmlElement &e) {
+        if (e.id == 0x114D9B74) {
+            // SeekHead, in case Info/Tracks are not before the first cluster
+            ebml_children(source, e, limit, [&](const EbmlElement &seek) {
+                uint64_t id = 0, pos = 0;
+                ebml_children(source, seek, limit, [&](const EbmlElement &s) {
+                    if (s.id == 0x53AB) {
+                        id = ebml_uint(source, s);
+                    } else if (s.id == 0x53AC) {
+                        pos = ebml_uint(source, s);
+                    }
+                    return true;
+                });
+                if (id == 0x1549A966) {
+                    infoPos = segment.data + (int64_t) pos;
+                } else if (id == 0x1654AE6B) {
+                    tracksPos = segment.data + (int64_t) pos;
+                }
+                return true;
+            });
+        } else if (e.id == 0x1549A966) {
+            parseInfo(e);
+        } else if (e.id == 0x1654AE6B) {
+            parseTracks(e);
+        } else if (e.id == 0x1F43B675) {
+            // cluster, headers are done
+            return false;
+        }
+        return !(hasInfo && hasTracks);
+    });
+
+    if (!hasInfo && infoPos > 0 && ebml_element(source, infoPos, &element) && element.id == 0x1549A966) {
+        parseInfo(element);
+    }
+    if (!hasTracks && tracksPos > 0 && ebml_element(source, tracksPos, &element) && element.id == 0x1654AE6B) {
+        parseTracks(element);
+    }
+
+    if (!hasTracks || (info.videos.empty() && info.audios.empty())) {
+        return false;
+    }
+
+    mediaInfo->videos = info.videos;
+    mediaInfo->audios = info.audios;
+    mediaInfo->subtitles = info.subtitles;
+    mediaInfo->duration = (long) (duration * (double) timecodeScale / 1000000000.0);
+
+    return true;
+}
+
+//
+// mp4 / mov
+//
+
+static void mp4_boxes(const uint8_t *data, size_t size,
+                      const std::function<void(uint32_t type, const uint8_t *data, size_t size)> &callback) {
+
+    size_t pos = 0;
+    while (pos + 8 <= size) {
+        uint64_t len = be32(data + pos);
+        uint32_t type = be32(data + pos + 4);
+        size_t header = 8;
+        if (len == 1) {
+            if (pos + 16 > size) {
+                break;
+            }
+            len = be64(data + pos + 8);
+            header = 16;
+        } else if (len == 0) {
+            len = size - pos;
+        }
+        if (len < header || len > size - pos) {
+            break;
+        }
+        callback(type, data + pos + header, (size_t) len - header);
+        pos += (size_t) len;
+    }
+}
+
+static std::string mp4_codec(uint32_t type) {
+
+    switch (type) {
+        case 0x61766331: // avc1
+        case 0x61766333: // avc3
+            return "h264";
+        case 0x68766331: // hvc1
+        case 0x68657631: // hev1
+            return "hevc";
+        case 0x76703039: // vp09
+            return "vp9";
+        case 0x61763031: // av01
+            return "av1";
+        case 0x6D703476: // mp4v
+            return "mpeg4";
+        case 0x6D703461: // mp4a
+            return "aac";
+        case 0x61632D33: // ac-3
+            return "ac3";
+        case 0x65632D33: // ec-3
+            return "eac3";
+        case 0x4F707573: // Opus
+            return "opus";
+        case 0x664C6143: // fLaC
+            return "flac";
+        case 0x2E6D7033: // .mp3
+            return "mp3";
+        case 0x74783367: // tx3g
+            return "mov_text";
+        case 0x77767474: // wvtt
+            return "webvtt";
+        default:
+            return fourcc_string(type);
+    }
+}
+
+static void mp4_trak(const uint8_t *data, size_t size, MediaInfo *mediaInfo) {
+
+    MediaInfo::Track track{};
+    track.title = "Unknown";
+    track.language = "N/A";
+    uint32_t handler = 0;
+
+    mp4_boxes(data, size, [&](uint32_t type, const uint8_t *d, size_t s) {
+        if (type == fourcc("tkhd")) {
+            // width / height (16.16) are the last fields
+            if (s >= 84) {
+                track.width = (int) (be32(d + s - 8) >> 16);
+                track.height = (int) (be32(d + s - 4) >> 16);
+            }
+        } else if (type == fourcc("mdia")) {
+            mp4_boxes(d, s, [&](uint32_t t, const uint8_t *md, size_t ms) {
+                if (t == fourcc("mdhd") && ms >= 24) {
+                    // packed iso-639-2/t language
+                    size_t off = md[0] == 1 ? 32 : 20;
+                    if (ms >= off + 2) {
+                        uint16_t l = be16(md + off);
+                        char lang[4] = {(char) (((l >> 10) & 0x1F) + 0x60), (char) (((l >> 5) & 0x1F) + 0x60),
+                                        (char) ((l & 0x1F) + 0x60), '\0'};
+                        if (l != 0 && l != 0x7FFF) {
+                            set_language(&track, lang);
+                        }
+                    }
+                } else if (t == fourcc("hdlr") && ms >= 12) {
+                    handler = be32(md + 8);
+                } else if (t == fourcc("minf")) {
+                    mp4_boxes(md, ms, [&](uint32_t mt, const uint8_t *nd, size_t ns) {
+                        if (mt != fourcc("stbl")) {
+                            return;
+                        }
+                        mp4_boxes(nd, ns, [&](uint32_t st, const uint8_t *sd, size_t ss) {
+                            // first sample description: version/flags(4) + count(4) + entry
+                            if (st != fourcc("stsd") || ss < 16) {
+                                return;
+                            }
+                            const uint8_t *entry = sd + 8;
+                            size_t entrySize = std::min((size_t) be32(entry), ss - 8);
+                            track.codec = mp4_codec(be32(entry + 4));
+                            if (handler == fourcc("vide") && entrySize >= 36) {
+                                track.width = be16(entry + 32);
+                                track.height = be16(entry + 34);
+                            } else if (handler == fourcc("soun") && entrySize >= 36) {
+                                track.channels = be16(entry + 24);
+                                track.sample_rate = be16(entry + 32);
+                            }
+                        });
+                    });
+                }
+            });
+        }
+    });
+
+    if (handler == fourcc("vide")) {
+        track.type = "video";
+    } else if (handler == fourcc("soun")) {
+        track.type = "audio";
+        track.width = track.height = 0;
+    } else if (handler == fourcc("sbtl") || handler == fourcc("subt") || handler == fourcc("text")) {
+        track.type = "sub";
+        track.width = track.height = 0;
+    } else {
+        return;
+    }
+
+    add_track(mediaInfo, track);
+}
+
+static bool parse_mp4(ByteSource *source, MediaInfo *mediaInfo) {
+
+    int64_t size = source->getSize();
+    int64_t pos = 0;
+    uint8_t header[16];
+
+    // top level boxes, skip mdat (moov at the end of non "faststart" files)
+    while (pos + 8 <= size) {
+        if (!source->read(pos, header, 8)) {
+            return false;
+        }
+        uint64_t len = be32(header);
+        uint32_t type = be32(header + 4);
+        size_t headerSize = 8;
+        if (len == 1) {
+            if (!source->read(pos + 8, header + 8, 8)) {
+                return false;
+            }
+            len = be64(header + 8);
+            headerSize = 16;
+        } else if (len == 0) {
+            len = (uint64_t) (size - pos);
+        }
+        if (len < headerSize) {
+            return false;
+        }
+
+        if (type == fourcc("moov")) {
+            if (len > MP4_MOOV_MAX) {
+                return false;
+            }
+            std::vector<uint8_t> moov(len - headerSize);
+            if (!source->read(pos + headerSize, moov.data(), moov.size())) {
+                return false;
+            }
+
+            MediaInfo info;
+            uint32_t timescale = 0;
+            uint64_t duration = 0;
+            mp4_boxes(moov.data(), moov.size(), [&](uint32_t t, const uint8_t *d, size_t s) {
+                if (t == fourcc("mvhd") && s >= 20) {
+                    if (d[0] == 1 && s >= 32) {
+                        timescale = be32(d + 20);
+                        duration = be64(d + 24);
+                    } else {
+                        timescale = be32(d + 12);
+                        duration = be32(d + 16);
+                    }
+                } else if (t == fourcc("trak")) {
+                    mp4_trak(d, s, &info);
+                }
+            });
+
+            if (info.videos.empty() && info.audios.empty()) {
+                return false;
+            }
+
+            mediaInfo->videos = info.videos;
+            mediaInfo->audios = info.audios;
+            mediaInfo->subtitles = info.subtitles;
+            mediaInfo->duration = timescale > 0 ? (long) (duration / timescale) : 0;
+            return true;
+        }
+
+        pos += (int64_t) len;
+    }
+
+    return false;
+}
+
+//
+// mpeg-ts / m2ts
+//
+
+class TsStream {
+public:
+    int pid;
+    int type;
+    std::string codec;
+    std::string language;
+    std::string kind;
+};
+
+static std::string ts_codec(int type, std::string *kind) {
+
+    *kind = "video";
+    switch (type) {
+        case 0x01:
+            return "mpeg1video";
+        case 0x02:
+            return "mpeg2video";
+        case 0x10:
+            return "mpeg4";
+        case 0x1B:
+            return "h264";
+        case 0x24:
+            return "hevc";
+        case 0xEA:
+            return "vc1";
+        default:
+            break;
+    }
+
+    *kind = "audio";
+    switch (type) {
+        case 0x03:
+        case 0x04:
+            return "mp3";
+        case 0x0F:
+            return "aac";
+        case 0x11:
+            return "aac_latm";
+        case 0x80:
+            return "pcm_bluray";
+        case 0x81:
+            return "ac3";
+        case 0x82:
+        case 0x85:
+        case 0x86:
+            return "dts";
+        case 0x83:
+            return "truehd";
+        case 0x84:
+        case 0x87:
+            return "eac3";
+        default:
+            break;
+    }
+
+    *kind = "sub";
+    switch (type) {
+        case 0x90:
+            return "hdmv_pgs_subtitle";
+        case 0x92:
+            return "hdmv_text_subtitle";
+        default:
+            break;
+    }
+
+    kind->clear();
+    return "";
+}
+
+static int ts_packet_size(const uint8_t *data, size_t size, int *offset) {
+
+    for (int ps : {188, 192}) {
+        int off = ps == 192 ? 4 : 0;
+        if (size >= (size_t) (off + ps * 2 + 1)
+            && data[off] == 0x47 && data[off + ps] == 0x47 && data[off + ps * 2] == 0x47) {
+            *offset = off;
+            return ps;
+        }
+    }
+
+    return 0;
+}
+
+// pcr base (90khz) from adaptation field, -1 if none
+static int64_t ts_pcr(const uint8_t *p) {
+
+    if (!(p[3] & 0x20) || p[4] < 7 || !(p[5] & 0x10)) {
+        return -1;
+    }
+
+    return ((int64_t) p[6] << 25) | ((int64_t) p[7] << 17) | ((int64_t) p[8] << 9)
+           | ((int64_t) p[9] << 1) | (p[10] >> 7);
+}
+
+static const uint8_t *ts_section(const uint8_t *p, size_t *length) {
+
+    // payload unit start only, sections are assumed to fit a single packet
+    if (!(p[1] & 0x40) || !(p[3] & 0x10)) {
+        return nullptr;
+    }
+
+    size_t off = 4;
+    if (p[3] & 0x20) {
+        off += 1 + p[4];
+    }
+    if (off >= 188) {
+        return nullptr;
+    }
+    off += 1 + p[off]; // pointer field
+    if (off + 3 > 188) {
+        return nullptr;
+    }
+
+    size_t len = ((p[off + 1] & 0x0F) << 8 | p[off + 2]) + 3;
+    if (off + len > 188) {
+        return nullptr;
+    }
+
+    *length = len;
+    return p + off;
+}
+
+static bool parse_ts(ByteSource *source, MediaInfo *mediaInfo) {
+
+    int64_t size = source->getSize();
+    std::vector<uint8_t> data((size_t) std::min((int64_t) TS_SCAN_SIZE, size));
+    if (!source->read(0, data.data(), data.size())) {
+        return false;
+    }
+
+    int offset = 0;
+    int ps = ts_packet_size(data.data(), data.size(), &offset);
+    if (ps == 0) {
+        return false;
+    }
+
+    int pmtPid = -1;
+    int64_t pcrFirst = -1;
+    std::vector<TsStream> streams;
+
+    for (size_t pos = (size_t) offset; pos + 188 <= data.size() && (streams.empty() || pcrFirst < 0); pos += ps) {
+        const uint8_t *p = data.data() + pos;
+        if (p[0] != 0x47) {
+            return false;
+        }
+        int pid = ((p[1] & 0x1F) << 8) | p[2];
+        if (pcrFirst < 0) {
+            pcrFirst = ts_pcr(p);
+        }
+
+        size_t len;
+        const uint8_t *section;
+        if (pid == 0 && pmtPid < 0 && (section = ts_section(p, &len)) && section[0] == 0x00 && len >= 12) {
+            // pat: first program
+            for (size_t i = 8; i + 4 <= len - 4; i += 4) {
+                if (be16(section + i) != 0) {
+                    pmtPid = be16(section + i + 2) & 0x1FFF;
+                    break;
+                }
+            }
+        } else if (pid == pmtPid && streams.empty() && (section = ts_section(p, &len)) && section[0] == 0x02 && len >= 16) {
+            size_t i = 12 + (be16(section + 10) & 0x0FFF);
+            while (i + 5 <= len - 4) {
+                TsStream stream{};
+                stream.type = section[i];
+                stream.pid = be16(section + i + 1) & 0x1FFF;
+                size_t esLen = be16(section + i + 3) & 0x0FFF;
+                stream.codec = ts_codec(stream.type, &stream.kind);
+                // descriptors
+                for (size_t d = i + 5; d + 2 <= i + 5 + esLen && d + 2 <= len - 4; d += 2 + section[d + 1]) {
+                    uint8_t tag = section[d];
+                    uint8_t dlen = section[d + 1];
+                    const uint8_t *dd = section + d + 2;
+                    if ((tag == 0x0A || tag == 0x59) && dlen >= 3) {
+                        stream.language = std::string((const char *) dd, 3);
+                    } else if (stream.type == 0x06 && tag == 0x6A) {
+                        stream.codec = "ac3", stream.kind = "audio";
+                    } else if (stream.type == 0x06 && tag == 0x7A) {
+                        stream.codec = "eac3", stream.kind = "audio";
+                    } else if (stream.type == 0x06 && tag == 0x7B) {
+                        stream.codec = "dts", stream.kind = "audio";
+                    } else if (stream.type == 0x06 && tag == 0x59) {
+                        stream.codec = "dvb_subtitle", stream.kind = "sub";
+                    } else if (stream.type == 0x06 && tag == 0x56) {
+                        stream.codec = "dvb_teletext", stream.kind = "sub";
+                    }
+                }
+                if (!stream.kind.empty()) {
+                    streams.push_back(stream);
+                }
+                i += 5 + esLen;
+            }
+            if (streams.empty()) {
+                return false;
+            }
+        }
+    }
+
+    if (streams.empty()) {
+        return false;
+    }
+
+    // duration from last pcr, in the last part of the file
+    int64_t pcrLast = -1;
+    if (pcrFirst >= 0) {
+        int64_t tailPos = std::max((int64_t) 0, size - TS_TAIL_SIZE);
+        std::vector<uint8_t> tail((size_t) (size - tailPos));
+        if (source->read(tailPos, tail.data(), tail.size())) {
+            // resync on packet boundaries
+            for (size_t start = 0; start < (size_t) ps && pcrLast < 0; start++) {
+                if (tail.size() < start + ps * 3 || tail[start] != 0x47
+                    || tail[start + ps] != 0x47 || tail[start + ps * 2] != 0x47) {
+                    continue;
+                }
+                for (size_t pos = start; pos + 188 <= tail.size(); pos += ps) {
+                    if (tail[pos] != 0x47) {
+                        continue;
+                    }
+                    int64_t pcr = ts_pcr(tail.data() + pos);
+                    if (pcr >= 0) {
+                        pcrLast = pcr;
+                    }
+                }
+            }
+        }
+    }
+
+    MediaInfo info;
+    for (auto &stream : streams) {
+        MediaInfo::Track track{};
+        track.title = "Unknown";
+        track.language = "N/A";
+        track.type = stream.kind;
+        track.codec = stream.codec;
+        set_language(&track, stream.language);
+        // no resolution without parsing the bitstream
+        add_track(&info, track);
+    }
+
+    if (info.videos.empty() && info.audios.empty()) {
+        return false;
+    }
+
+    mediaInfo->videos = info.videos;
+    mediaInfo->audios = info.audios;
+    mediaInfo->subtitles = info.subtitles;
+    mediaInfo->duration = 0;
+    if (pcrFirst >= 0 && pcrLast >= 0) {
+        if (pcrLast < pcrFirst) {
+            pcrLast += (int64_t) 1 << 33;
+        }
+        mediaInfo->duration = (long) ((pcrLast - pcrFirst) / 90000);
+    }
+
+    return true;
+}
+
+//
+// avi
+//
+
+static void riff_chunks(const uint8_t *data, size_t size,
+                        const std::function<void(uint32_t id, const uint8_t *data, size_t size)> &callback) {
+
+    size_t pos = 0;
+    while (pos + 8 <= size) {
+        uint32_t id = be32(data + pos);
+        size_t len = le32(data + pos + 4);
+        if (len > size - pos - 8) {
+            len = size - pos - 8;
+        }
+        callback(id, data + pos + 8, len);
+        pos += 8 + len + (len & 1);
+    }
+}
+
+static std::string avi_video_codec(uint32_t compression) {
+
+    // biCompression read big endian, in file order
+    std::string fcc = fourcc_string(compression);
+
+    static const char *codecs[][2] = {
+            {"xvid", "mpeg4"}, {"divx", "mpeg4"}, {"dx50", "mpeg4"}, {"fmp4", "mpeg4"},
+            {"mp4v", "mpeg4"}, {"3iv2", "mpeg4"}, {"div3", "msmpeg4v3"}, {"mp43", "msmpeg4v3"},
+            {"h264", "h264"}, {"x264", "h264"}, {"avc1", "h264"}, {"hevc", "hevc"},
+            {"h265", "hevc"}, {"hvc1", "hevc"}, {"mjpg", "mjpeg"}, {"wmv3", "wmv3"},
+            {"mpg2", "mpeg2video"}, {"vp80", "vp8"},
+    };
+
+    for (auto &codec : codecs) {
+        if (fcc == codec[0]) {
+            return codec[1];
+        }
+    }
+
+    return fcc;
+}
+
+static std::string avi_audio_codec(uint16_t tag) {
+
+    switch (tag) {
+        case 0x0001:
+        case 0xFFFE:
+            return "pcm_s16le";
+        case 0x0050:
+            return "mp2";
+        case 0x0055:
+            return "mp3";
+        case 0x00FF:
+        case 0x1610:
+            return "aac";
+        case 0x0161:
+            return "wmav2";
+        case 0x2000:
+            return "ac3";
+        case 0x2001:
+            return "dts";
+        default:
+            return "unknown";
+    }
+}
+
+static bool parse_avi(ByteSource *source, MediaInfo *mediaInfo) {
+
+    uint8_t header[24];
+    if (!source->read(0, header, 24)
+        || be32(header) != fourcc("RIFF") || be32(header + 8) != fourcc("AVI ")
+        || be32(header + 12) != fourcc("LIST") || be32(header + 20) != fourcc("hdrl")) {
+        return false;
+    }
+
+    size_t len = le32(header + 16);
+    if (len < 4 || len > AVI_HDRL_MAX) {
+        return false;
+    }
+    std::vector<uint8_t> hdrl(len - 4);
+    if (!source->read(24, hdrl.data(), hdrl.size())) {
+        return false;
+    }
+
+    MediaInfo info;
+    double duration = 0, videoDuration = 0;
+    uint32_t usPerFrame = 0, totalFrames = 0;
+
+    riff_chunks(hdrl.data(), hdrl.size(), [&](uint32_t id, const uint8_t *d, size_t s) {
+        if (id == fourcc("avih") && s >= 40) {
+            usPerFrame = le32(d);
+            totalFrames = le32(d + 16);
+        } else if (id == fourcc("LIST") && s >= 4 && be32(d) == fourcc("odml")) {
+            riff_chunks(d + 4, s - 4, [&](uint32_t oid, const uint8_t *od, size_t os) {
+                // opendml total frames, avih only counts the first riff
+                if (oid == fourcc("dmlh") && os >= 4) {
+                    totalFrames = le32(od);
+                }
+            });
+        } else if (id == fourcc("LIST") && s >= 4 && be32(d) == fourcc("strl")) {
+            MediaInfo::Track track{};
+            track.title = "Unknown";
+            track.language = "N/A";
+            uint32_t type = 0;
+            riff_chunks(d + 4, s - 4, [&](uint32_t sid, const uint8_t *sd, size_t ss) {
+                if (sid == fourcc("strh") && ss >= 36) {
+                    type = be32(sd);
+                    uint32_t scale = le32(sd + 20), rate = le32(sd + 24), length = le32(sd + 32);
+                    if (type == fourcc("vids") && rate > 0) {
+                        videoDuration = (double) length * scale / rate;
+                    }
+                } else if (sid == fourcc("strf")) {
+                    if (type == fourcc("vids") && ss >= 20) {
+                        track.width = (int) le32(sd + 4);
+                        track.height = std::abs((int) le32(sd + 8));
+                        track.codec = avi_video_codec(be32(sd + 16));
+                    } else if (type == fourcc("auds") && ss >= 8) {
+                        track.codec = avi_audio_codec(le16(sd));
+                        track.channels = le16(sd + 2);
+                        track.sample_rate = (int) le32(sd + 4);
+                    }
+                } else if (sid == fourcc("strn") && ss > 0) {
+                    track.title = std::string((const char *) sd, strnlen((const char *) sd, ss));
+                }
+            });
+            if (type == fourcc("vids")) {
+                track.type = "video";
+                add_track(&info, track);
+            } else if (type == fourcc("auds")) {
+                track.type = "audio";
+                add_track(&info, track);
+            } else if (type == fourcc("txts")) {
+                track.type = "sub";
+                add_track(&info, track);
+            }
+        }
+    });
+
+    if (info.videos.empty() && info.audios.empty()) {
+        return false;
+    }
+
+    duration = videoDuration > 0 ? videoDuration : (double) usPerFrame * totalFrames / 1000000.0;
+
+    mediaInfo->videos = info.videos;
+    mediaInfo->audios = info.audios;
+    mediaInfo->subtitles = info.subtitles;
+    mediaInfo->duration = (long) duration;
+
+    return true;
+}
+
+ContainerParser::Container ContainerParser::getContainer(ByteSource *source) {
+
+    uint8_t h[12];
+    if (!source->read(0, h, 12)) {
+        return Container::Unknown;
+    }
+
+    uint32_t type = be32(h + 4);
+    if (be32(h) == 0x1A45DFA3) {
+        return Container::Matroska;
+    } else if (type == fourcc("ftyp") || type == fourcc("moov") || type == fourcc("mdat")
+               || type == fourcc("free") || type == fourcc("wide") || type == fourcc("skip")) {
+        return Container::Mp4;
+    } else if (be32(h) == fourcc("RIFF") && be32(h + 8) == fourcc("AVI ")) {
+        return Container::Avi;
+    } else if (h[0] == 0x47 || h[4] == 0x47) {
+        return Container::MpegTs;
+    }
+
+    return Container::Unknown;
+}
+
+bool ContainerParser::parse(ByteSource *source, MediaInfo *mediaInfo) {
+
+    switch (getContainer(source)) {
+        case Container::Matroska:
+            return parse_mkv(source, mediaInfo);
+        case Container::Mp4:
+            return parse_mp4(source, mediaInfo);
+        case Container::MpegTs:
+            return parse_ts(source, mediaInfo);
+        case Container::Avi:
+            return parse_avi(source, mediaInfo);
+        default:
+            return false;
+    }
+}
+
+bool ContainerParser::parse(const c2d::Io::File &file, MediaInfo *mediaInfo) {
+
+    ByteSource *source = ByteSource::create(file.path);
+    if (!source) {
+        return false;
+    }
+
+    bool res = parse(source, mediaInfo);
+    delete (source);
+
+    return res;
+}
@@ -0,0 +1,35 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_CONTAINER_PARSER_H
+#define PPLAY_CONTAINER_PARSER_H
+
+#include "cross2d/skeleton/io.h"
+#include "media_info.h"
+
+namespace pplay {
+
+    class ByteSource;
+
+    // reads tracks and duration from container headers only (matroska, mp4, mpeg-ts, avi),
+    // without starting a mpv core. Codec names and track ids match mpv "track-list".
+    class ContainerParser {
+
+    public:
+
+        enum class Container {
+            Unknown, Matroska, Mp4, MpegTs, Avi
+        };
+
+        // false if the container is not supported or headers could not be read,
+        // mediaInfo tracks and duration are only modified on success
+        static bool parse(const c2d::Io::File &file, MediaInfo *mediaInfo);
+
+        static bool parse(ByteSource *source, MediaInfo *mediaInfo);
+
+        static Container getContainer(ByteSource *source);
+    };
+}
+
+#endif //PPLAY_CONTAINER_PARSER_H
@@ -0,0 +1,198 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include "main.h"
+#include "mpv.h"
+#include "prober.h"
+#include "container_parser.h"
+
+#define PROBER_WORKERS_MAX  2
+// seconds to wait for FILE_LOADED (network files..)
+#define PROBER_TIMEOUT      10
+
+using namespace pplay;
+
+static bool probe_file(Prober *prober, Mpv *mpv, const c2d::Io::File &file, MediaInfo *mediaInfo) {
+
+    if (mpv->load(file.path, Mpv::LoadType::Replace, "pause=yes") != 0) {
+        return false;
+    }
+
+    // END_FILE of the previous file may still be queued, only trust it after START_FILE
+    bool started = false, loaded = false, done = false;
+    auto start = std::chrono::steady_clock::now();
+
+    while (!done && prober->running) {
+        mpv->pollEvents([&started, &loaded, &done](mpv_event *event) {
+            if (event->event_id == MPV_EVENT_START_FILE) {
+                started = true;
+            } else if (event->event_id == MPV_EVENT_FILE_LOADED) {
+                loaded = done = true;
+            } else if (event->event_id == MPV_EVENT_END_FILE && started) {
+                done = true;
+            }
+        }, 0.1);
+
+        std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() > PROBER_TIMEOUT) {
+            printf("Prober: timeout: %s\n", file.path.c_str());
+            break;
+        }
+    }
+
+    if (loaded) {
+        *mediaInfo = mpv->getMediaInfo(file);
+    }
+    mpv->stop();
+
+    return loaded;
+}
+
+static int probe_thread(void *ptr) {
+
+    auto worker = (Prober::Worker *) ptr;
+    auto prober = worker->prober;
+
+    // only created when the native parser fails
+    Mpv *mpv = nullptr;
+
+    while (true) {
+
+        SDL_LockMutex(prober->mutex);
+        while (prober->running && prober->jobs.empty()) {
+            SDL_CondWait(prober->cond, prober->mutex);
+        }
+        if (!prober->running) {
+            SDL_UnlockMutex(prober->mutex);
+            break;
+        }
+        c2d::Io::File file = prober->jobs.front();
+        prober->jobs.pop_front();
+        SDL_UnlockMutex(prober->mutex);
+
+        MediaInfo mediaInfo(file);
+        auto start = std::chrono::steady_clock::now();
+        bool native = ContainerParser::parse(file, &mediaInfo);
+        bool probed = native;
+        if (!native) {
+            if (!mpv) {
+                mpv = new Mpv(prober->configPath, false);
+            }
+            probed = mpv->isAvailable() && probe_file(prober, mpv, file, &mediaInfo);
+        }
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        SDL_LockMutex(prober->mutex);
+        auto &stats = native ? prober->nativeStats : prober->mpvStats;
+        stats.count++;
+        stats.time += elapsed.count();
+        stats.time_max = std::max(stats.time_max, elapsed.count());
+        if (probed) {
+            prober->results.push_back({file, mediaInfo});
+        }
+        SDL_UnlockMutex(prober->mutex);
+
+        if (probed) {
+            mediaInfo.save(file);
+            printf("Prober: %s (%s, %.0f ms)\n", file.name.c_str(), native ? "native" : "mpv", elapsed.count());
+        }
+    }
+
+    if (mpv) {
+        delete (mpv);
+    }
+
+    return 0;
+}
+
+Prober::Prober(Main *m) {
+
+    main = m;
+    configPath = main->getIo()->getDataPath() + "mpv";
+    mutex = SDL_CreateMutex();
+    cond = SDL_CreateCond();
+
+    // leave cores to the ui and player, probing is mostly io bound anyway
+    int cores = (int) std::thread::hardware_concurrency();
+    int count = std::max(1, std::min(cores / 2, PROBER_WORKERS_MAX));
+    for (int i = 0; i < count; i++) {
+        auto worker = new Worker();
+        worker->prober = this;
+        std::string name = "probe_thread" + std::to_string(i);
+        worker->thread = SDL_CreateThread(probe_thread, name.c_str(), (void *) worker);
+        workers.push_back(worker);
+    }
+}
+
+void Prober::probe(const std::vector<c2d::Io::File> &files) {
+
+    SDL_LockMutex(mutex);
+    jobs.clear();
+    jobs.insert(jobs.end(), files.begin(), files.end());
+    SDL_UnlockMutex(mutex);
+
+    SDL_CondBroadcast(cond);
+}
+
+void Prober::add(const std::vector<c2d::Io::File> &files) {
+
+    SDL_LockMutex(mutex);
+    jobs.insert(jobs.end(), files.begin(), files.end());
+    SDL_UnlockMutex(mutex);
+
+    SDL_CondBroadcast(cond);
+}
+
+void Prober::prioritize(const std::vector<std::string> &paths) {
+
+    SDL_LockMutex(mutex);
+    // stable: visible rows keep their queue order, as do the others
+    std::stable_partition(jobs.begin(), jobs.end(), [&paths](const c2d::Io::File &file) {
+        return std::find(paths.begin(), paths.end(), file.path) != paths.end();
+    });
+    SDL_UnlockMutex(mutex);
+}
+
+int Prober::poll(const Callback &callback) {
+
+    std::vector<Result> done;
+
+    SDL_LockMutex(mutex);
+    done.swap(results);
+    SDL_UnlockMutex(mutex);
+
+    for (auto &result : done) {
+        callback(result.file, result.mediaInfo);
+    }
+
+    return (int) done.size();
+}
+
+Prober::~Prober() {
+
+    SDL_LockMutex(mutex);
+    running = false;
+    jobs.clear();
+    SDL_UnlockMutex(mutex);
+    SDL_CondBroadcast(cond);
+
+    for (auto worker : workers) {
+        SDL_WaitThread(worker->thread, nullptr);
+        delete (worker);
+    }
+
+    SDL_DestroyCond(cond);
+    SDL_DestroyMutex(mutex);
+
+    // probe latency per file, native parser vs mpv
+    for (auto stats : {&nativeStats, &mpvStats}) {
+        printf("Prober::~Prober: %s: %i files, avg: %.1f ms, max: %.1f ms\n",
+               stats == &nativeStats ? "native" : "mpv", stats->count,
+               stats->count > 0 ? stats->time / (float) stats->count : 0, stats->time_max);
+    }
+}
@@ -0,0 +1,79 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_PROBER_H
+#define PPLAY_PROBER_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include <SDL2/SDL_thread.h>
+
+#include "cross2d/skeleton/io.h"
+#include "media_info.h"
+
+class Main;
+
+namespace pplay {
+
+    // headless mpv instances, probing media files in background so
+    // media information is available before a file is played
+    class Prober {
+
+    public:
+
+        typedef std::function<void(const c2d::Io::File &file, const MediaInfo &mediaInfo)> Callback;
+
+        explicit Prober(Main *main);
+
+        ~Prober();
+
+        // replace pending jobs (directory change)
+        void probe(const std::vector<c2d::Io::File> &files);
+
+        // append to pending jobs
+        void add(const std::vector<c2d::Io::File> &files);
+
+        // move pending jobs of these files (visible rows) to the front of the queue
+        void prioritize(const std::vector<std::string> &paths);
+
+        // call from ui thread, returns results count
+        int poll(const Callback &callback);
+
+        class Worker {
+        public:
+            Prober *prober = nullptr;
+            SDL_Thread *thread = nullptr;
+        };
+
+        class Result {
+        public:
+            c2d::Io::File file;
+            MediaInfo mediaInfo;
+        };
+
+        class Stats {
+        public:
+            int count = 0;
+            float time = 0;
+            float time_max = 0;
+        };
+
+        Main *main;
+        std::string configPath;
+        std::vector<Worker *> workers;
+        std::deque<c2d::Io::File> jobs;
+        std::vector<Result> results;
+        Stats nativeStats;
+        Stats mpvStats;
+        SDL_mutex *mutex = nullptr;
+        SDL_cond *cond = nullptr;
+        // also read by workers while probing (abort)
+        std::atomic<bool> running{true};
+    };
+}
+
+#endif //PPLAY_PROBER_H
@@ -5,38 +5,15 @@
 #include <utility.h>
 #include "main.h"
 #include "scrapper.h"
+#include "library.h"
+#include "library_search.h"
 #include "p_search.h"
 
 using namespace pplay;
 using namespace pscrap;
 
-static std::vector<c2d::Io::File> scrapList;
-
-static void find_medias(Main *main, const std::string &path) {
-
-    std::vector<std::string> ext = pplay::Utility::getMediaExtensions();
-    pplay::Io::DeviceType type = ((pplay::Io *) main->getIo())->getType(path);
-    std::vector<c2d::Io::File> files =
-            ((pplay::Io *) main->getIo())->getDirList(type, ext, path);
-
-    if (files.empty()) {
-        return;
-    }
-
-    for (auto &file : files) {
-        if (!main->getScrapper()->running) {
-            break;
-        }
-        if (file.type == c2d::Io::Type::Directory) {
-            if (file.name == "." || file.name == "..") {
-                continue;
-            }
-            find_medias(main, file.path);
-        } else {
-            scrapList.emplace_back(file);
-        }
-    }
-}
+// files found but not scrapped yet, the scan waits when full
+#define SCRAP_QUEUE_MAX 64
 
 #define TOKEN_COUNT 11
 static const char *tokens[TOKEN_COUNT] = {
@@ -74,6 +51,35 @@ static std::string clean_name(const std::string &name) {
     return search;
 }
 
+static int crawl_thread(void *ptr) {
+
+    auto scrapper = (Scrapper *) ptr;
+
+    // only changed directories are listed again, files to scrap
+    // are queued as soon as their directory is listed
+    Library::getInstance()->scan(
+            (pplay::Io *) scrapper->main->getIo(), scrapper->path, &scrapper->running,
+            [scrapper](const Library::Entry &entry) {
+                SDL_LockMutex(scrapper->queueMutex);
+                while (scrapper->running && scrapper->queue.size() >= SCRAP_QUEUE_MAX) {
+                    SDL_CondWait(scrapper->queueCond, scrapper->queueMutex);
+                }
+                if (scrapper->running) {
+                    scrapper->queue.push_back(entry);
+                    scrapper->found++;
+                }
+                SDL_CondBroadcast(scrapper->queueCond);
+                SDL_UnlockMutex(scrapper->queueMutex);
+            });
+
+    SDL_LockMutex(scrapper->queueMutex);
+    scrapper->crawling = false;
+    SDL_CondBroadcast(scrapper->queueCond);
+    SDL_UnlockMutex(scrapper->queueMutex);
+
+    return 0;
+}
+
 static int scrap_thread(void *ptr) {
 
     auto scrapper = (Scrapper *) ptr;
@@ -94,26 +100,53 @@ static int scrap_thread(void *ptr) {
 
             c2d::C2DClock clock;
 
-            scrapList.clear();
-            find_medias(main, scrapper->path);
+            Library *library = Library::getInstance();
+            scrapper->queue.clear();
+            scrapper->found = 0;
+            scrapper->crawling = true;
+            SDL_Thread *crawler = SDL_CreateThread(crawl_thread, "crawl_thread", (void *) scrapper);
+            if (!crawler) {
+                // no crawl thread, scan first then scrap
+                library->scan((pplay::Io *) main->getIo(), scrapper->path, &scrapper->running);
+                std::vector<Library::Entry> scrapList = library->getUnscrapped(scrapper->path);
+                scrapper->queue.assign(scrapList.begin(), scrapList.end());
+                scrapper->found = scrapList.size();
+                scrapper->crawling = false;
+            }
 
-            size_t size = scrapList.size();
-            for (size_t i = 0; i < size; i++) {
+            size_t i = 0;
+            while (true) {
 
-                if (!main->getScrapper()->running) {
+                // next file, waiting for the crawler
+                SDL_LockMutex(scrapper->queueMutex);
+                while (scrapper->running && scrapper->crawling && scrapper->queue.empty()) {
+                    SDL_CondWait(scrapper->queueCond, scrapper->queueMutex);
+                }
+                if (!scrapper->running || scrapper->queue.empty()) {
+                    SDL_UnlockMutex(scrapper->queueMutex);
                     break;
                 }
-
-                c2d::Io::File file = scrapList.at(i);
+                Library::Entry entry = std::move(scrapper->queue.front());
+                scrapper->queue.pop_front();
+                size_t size = scrapper->found;
+                bool crawling = scrapper->crawling;
+                SDL_CondBroadcast(scrapper->queueCond);
+                SDL_UnlockMutex(scrapper->queueMutex);
+
+                c2d::Io::File file = entry.getFile();
                 std::string scrap_path = pplay::Utility::getMediaScrapPath(file);
-                if (!main->getIo()->exist(scrap_path)) {
-                    std::string title = "Scrapping... (" + std::to_string(i) + "/" + std::to_string(size) + ")";
+                if (main->getIo()->exist(scrap_path)) {
+                    library->setScrapped(file.path);
+                } else {
+                    std::string title = "Scrapping... (" + std::to_string(i) + "/" + std::to_string(size)
+                                        + (crawling ? "+" : "") + ")";
                     main->getStatus()->show(title, "Searching: " + file.name, true);
                     std::string lang = main->getConfig()->getOption(OPT_TMDB_LANGUAGE)->getString();
                     Search search(API_KEY, clean_name(file.name), lang);
                     int res = search.get();
                     if (res == 0) {
                         search.save(scrap_path);
+                        library->setScrapped(file.path);
                         if (search.total_results > 0) {
                             main->getStatus()->show(title, "Downloading poster: "
                                                            + search.movies.at(0).title, true);
@@ -126,8 +159,17 @@ static int scrap_thread(void *ptr) {
                         }
                     }
                 }
+                i++;
+            }
+
+            if (crawler) {
+                SDL_WaitThread(crawler, nullptr);
             }
 
+            library->save();
+            // index new scrap data for library search
+            main->getStatus()->show("Scrapping...", "Updating search index...", true);
+            LibrarySearch::getInstance()->update(library, &scrapper->running);
             scrapper->main->getStatus()->show(
                     "Scrapping...", "Done in "
                                     + pplay::Utility::formatTime(clock.getElapsedTime().asSeconds()));
@@ -148,6 +190,8 @@ Scrapper::Scrapper(Main *m) {
     main = m;
     mutex = SDL_CreateMutex();
     cond = SDL_CreateCond();
+    queueMutex = SDL_CreateMutex();
+    queueCond = SDL_CreateCond();
     thread = SDL_CreateThread(scrap_thread, "scrap_thread", (void *) this);
 }
 
@@ -167,8 +211,14 @@ Scrapper::~Scrapper() {
 
     scrapping = false;
     running = false;
+    // wake up crawler / scrapper waiting on the queue
+    SDL_LockMutex(queueMutex);
+    SDL_CondBroadcast(queueCond);
+    SDL_UnlockMutex(queueMutex);
     SDL_CondSignal(cond);
     SDL_WaitThread(thread, nullptr);
     SDL_DestroyCond(cond);
+    SDL_DestroyCond(queueCond);
+    SDL_DestroyMutex(queueMutex);
     printf("Scrapper::~Scrapper\n");
 }
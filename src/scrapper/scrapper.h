@@ -5,8 +5,11 @@
 #ifndef PPLAY_SCRAPPER_H
 #define PPLAY_SCRAPPER_H
 
+#include <atomic>
+#include <deque>
 #include <SDL2/SDL_thread.h>
 #include "cross2d/skeleton/sfml/RectangleShape.hpp"
+#include "library.h"
 
 class Main;
 
@@ -27,8 +30,15 @@ namespace pplay {
         SDL_mutex *mutex = nullptr;
         SDL_cond *cond = nullptr;
         SDL_Thread *thread = nullptr;
-        bool scrapping = false;
-        bool running = true;
+        // read by crawl / scan workers and ui thread
+        std::atomic<bool> scrapping{false};
+        std::atomic<bool> running{true};
+        // files to scrap, filled by the library scan (crawl thread) while scrapping
+        std::deque<Library::Entry> queue;
+        SDL_mutex *queueMutex = nullptr;
+        SDL_cond *queueCond = nullptr;
+        bool crawling = false;
+        size_t found = 0;
     };
 }
 
@@ -0,0 +1,83 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#include "cross2d/c2d.h"
+#include "serializer.h"
+#include "utility.h"
+
+using namespace pplay;
+
+static void put32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t) (v >> (i * 8));
+    }
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+bool DataFile::read(const std::string &path, uint32_t magic, uint32_t version, std::string *body) {
+
+    // interrupted write
+    std::string tmp = path + ".tmp";
+    if (!c2d_renderer->getIo()->exist(path) && c2d_renderer->getIo()->exist(tmp)) {
+        rename(tmp.c_str(), path.c_str());
+    }
+
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+
+    std::string data;
+    char buffer[64 * 1024];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        data.append(buffer, read);
+    }
+    fclose(fp);
+
+    auto p = (const uint8_t *) data.data();
+    if (data.size() < 12 || get32(p) != magic || get32(p + 4) != version
+        || get32(p + data.size() - 4) != Utility::crc32(p, data.size() - 4)) {
+        printf("DataFile::read: %s is invalid\n", path.c_str());
+        return false;
+    }
+
+    body->assign(data, 8, data.size() - 12);
+
+    return true;
+}
+
+bool DataFile::write(const std::string &path, uint32_t magic, uint32_t version, const std::string &body) {
+
+    uint8_t header[8], trailer[4];
+    put32(header, magic);
+    put32(header + 4, version);
+    uint32_t crc = Utility::crc32(header, 8);
+    put32(trailer, Utility::crc32(body.data(), body.size(), crc));
+
+    // write then rename, never leave a truncated file
+    std::string tmp = path + ".tmp";
+    FILE *fp = fopen(tmp.c_str(), "wb");
+    if (!fp) {
+        printf("DataFile::write: could not create %s\n", tmp.c_str());
+        return false;
+    }
+    bool success = fwrite(header, 1, 8, fp) == 8
+                   && fwrite(body.data(), 1, body.size(), fp) == body.size()
+                   && fwrite(trailer, 1, 4, fp) == 4;
+    success = fclose(fp) == 0 && success;
+    if (!success) {
+        remove(tmp.c_str());
+        return false;
+    }
+#ifdef __SWITCH__
+    // fat: rename doesn't replace existing files (tmp is recovered by read if we stop here)
+    remove(path.c_str());
+#endif
+
+    return rename(tmp.c_str(), path.c_str()) == 0;
+}
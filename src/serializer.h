@@ -0,0 +1,111 @@
+//
+// Created by cpasjuste on 17/10/26.
+//
+
+#ifndef PPLAY_SERIALIZER_H
+#define PPLAY_SERIALIZER_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace pplay {
+
+    // serialization helpers, all reads are bounds checked
+    class Writer {
+    public:
+        explicit Writer(std::string *o) : out(o) {}
+
+        void varint(uint64_t v) {
+            while (v >= 0x80) {
+                out->push_back((char) (v | 0x80));
+                v >>= 7;
+            }
+            out->push_back((char) v);
+        }
+
+        void svarint(int64_t v) {
+            // zigzag, -1 (no track) is a single byte
+            varint(((uint64_t) v << 1) ^ (uint64_t) (v >> 63));
+        }
+
+        void string(const std::string &s) {
+            varint(s.size());
+            out->append(s);
+        }
+
+        std::string *out;
+    };
+
+    class Reader {
+    public:
+        Reader(const uint8_t *data, size_t size) : p(data), end(data + size) {}
+
+        uint64_t varint() {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 64 && p < end; shift += 7) {
+                uint8_t b = *p++;
+                v |= (uint64_t) (b & 0x7F) << shift;
+                if (!(b & 0x80)) {
+                    return v;
+                }
+            }
+            ok = false;
+            return 0;
+        }
+
+        int64_t svarint() {
+            uint64_t v = varint();
+            return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+        }
+
+        void string(std::string *s) {
+            uint64_t len = varint();
+            if (!ok || len > (uint64_t) (end - p)) {
+                ok = false;
+                return;
+            }
+            s->assign((const char *) p, (size_t) len);
+            p += len;
+        }
+
+        // legacy format (raw native fields)
+        template<typename T>
+        T raw() {
+            T v{};
+            if ((size_t) (end - p) < sizeof(T)) {
+                ok = false;
+                return v;
+            }
+            memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+            return v;
+        }
+
+        void rawString(std::string *s) {
+            auto len = raw<size_t>();
+            if (!ok || len > (size_t) (end - p)) {
+                ok = false;
+                return;
+            }
+            s->assign((const char *) p, len);
+            p += len;
+        }
+
+        const uint8_t *p;
+        const uint8_t *end;
+        bool ok = true;
+    };
+
+    // whole file image: magic, version, body, crc32 of all previous bytes (little endian).
+    // Written to "path.tmp" then renamed, a ".tmp" left by an interrupted write is recovered on read
+    class DataFile {
+    public:
+        // body of a valid file, false if missing, corrupted or of another version
+        static bool read(const std::string &path, uint32_t magic, uint32_t version, std::string *body);
+
+        static bool write(const std::string &path, uint32_t magic, uint32_t version, const std::string &body);
+    };
+}
+
+#endif //PPLAY_SERIALIZER_H
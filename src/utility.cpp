@@ -3,6 +3,7 @@
 //
 
 #include <sstream>
+#include <fstream>
 #include <iomanip>
 
 #include "cross2d/c2d.h"
@@ -17,9 +18,9 @@
 
 using namespace pplay;
 
-std::string Utility::getMediaInfoPath(const c2d::Io::File &file) {
-    std::string hash = std::to_string(std::hash<std::string>()(file.path));
-    return c2d_renderer->getIo()->getDataPath() + "cache/" + hash + ".info";
+uint64_t Utility::getMediaInfoKey(const c2d::Io::File &file) {
+    // same hash as the old "cache/<hash>.info" files, see MediaStore migration
+    return (uint64_t) std::hash<std::string>()(file.path);
 }
 
 std::string Utility::getMediaScrapPath(const c2d::Io::File &file) {
@@ -149,6 +150,24 @@ std::string Utility::formatSize(size_t size) {
     return convertToString(roundOff(size_d)) + " " + sizes[div];
 }
 
+#if !defined(__SWITCH__) && defined(__linux__)
+// saved cpufreq governors, restored on CpuClock::Min
+static std::vector<std::string> cpu_governors;
+
+static std::string getCpuGovernorPath(int cpu) {
+    return "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpufreq/scaling_governor";
+}
+
+static bool setCpuGovernor(int cpu, const std::string &governor) {
+    std::ofstream fs(getCpuGovernorPath(cpu));
+    if (!fs.is_open()) {
+        return false;
+    }
+    fs << governor;
+    return fs.good();
+}
+#endif
+
 void Utility::setCpuClock(const CpuClock &clock) {
 #ifdef __SWITCH__
     if (clock == CpuClock::Min) {
@@ -169,7 +188,62 @@ void Utility::setCpuClock(const CpuClock &clock) {
         printf("setting max cpu speed (old: %i, new: %i)\n",
                clock_old, c2d::SwitchSys::getClock(c2d::SwitchSys::Module::Cpu));
     }
+#elif defined(__linux__)
+    // cpufreq governor, sysfs needs to be writable (root), else this is a no-op
+    if (clock == CpuClock::Min) {
+        for (size_t i = 0; i < cpu_governors.size(); i++) {
+            setCpuGovernor((int) i, cpu_governors[i]);
+        }
+        if (!cpu_governors.empty()) {
+            printf("restoring cpu governor (%s)\n", cpu_governors[0].c_str());
+            cpu_governors.clear();
+        }
+    } else if (cpu_governors.empty()) {
+        for (int i = 0;; i++) {
+            std::string governor;
+            std::ifstream fs(getCpuGovernorPath(i));
+            if (!fs.is_open() || !(fs >> governor)) {
+                break;
+            }
+            cpu_governors.push_back(governor);
+        }
+        for (size_t i = 0; i < cpu_governors.size(); i++) {
+            if (!setCpuGovernor((int) i, "performance")) {
+                printf("could not set cpu governor (cpu%i), skipping\n", (int) i);
+                for (size_t j = 0; j < i; j++) {
+                    setCpuGovernor((int) j, cpu_governors[j]);
+                }
+                cpu_governors.clear();
+                break;
+            }
+        }
+        if (!cpu_governors.empty()) {
+            printf("setting performance cpu governor (old: %s)\n", cpu_governors[0].c_str());
+        }
+    }
 #endif
 }
 
+uint32_t Utility::crc32(const void *data, size_t size, uint32_t crc) {
 
+    // thread safe static init, used from prober threads
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int j = 0; j < 8; j++) {
+                c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    auto p = (const uint8_t *) data;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
@@ -6,6 +6,7 @@
 #define PPLAY_UTILITY_H
 
 #include <string>
+#include <cstdint>
 #include "cross2d/skeleton/io.h"
 
 namespace pplay {
@@ -19,7 +20,8 @@ namespace pplay {
             Max = 1
         };
 
-        static std::string getMediaInfoPath(const c2d::Io::File &file);
+        // media store key (path hash)
+        static uint64_t getMediaInfoKey(const c2d::Io::File &file);
 
         static std::string getMediaScrapPath(const c2d::Io::File &file);
 
@@ -39,6 +41,8 @@ namespace pplay {
 
         static void setCpuClock(const CpuClock &clock);
 
+        static uint32_t crc32(const void *data, size_t size, uint32_t crc = 0);
+
     };
 }
 